@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+const int    CMD_SIZE   = 201;
+const int    LABEL_NUM  = 100000;
+const char  *SRC_FILE   = "asm_bench.asm";
+const char  *EXE_FILE   = "asm_bench.cpu";
+
+/*---------------------------------------------------------*/
+
+bool   generate_source (const char *file_name, const int label_num);
+double get_time        ();
+
+/*---------------------------------------------------------*/
+
+/**
+*   @brief Measures "./Asm2" on the generated source with many marks.
+*   @brief Every mark is followed by a few commands and a jump to a pseudo-random mark, so there are both forward and backward jumps.
+*
+*   Usage: ./asm_bench [number of marks] [assembler]
+*/
+
+int main(int argc, const char *argv[])
+{
+    int         label_num = (argc > 1) ? atoi(argv[1]) : LABEL_NUM;
+    const char *asm_name  = (argc > 2) ? argv[2]       : "./Asm2";
+
+    if (label_num <= 0) label_num = LABEL_NUM;
+
+    if (!generate_source(SRC_FILE, label_num))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\"\n", SRC_FILE);
+        return 1;
+    }
+
+    char cmd[CMD_SIZE] = "";
+    snprintf(cmd, CMD_SIZE, "%s %s %s 2>/dev/null", asm_name, SRC_FILE, EXE_FILE);
+
+    double start  = get_time();
+    int    status = system(cmd);
+    double sec    = get_time() - start;
+
+    if (status != 0)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "\"%s\" failed\n", cmd);
+        return 1;
+    }
+
+    printf("%d marks, %d jumps: %.3f s\n", label_num, label_num + 1, sec);
+    return 0;
+}
+
+bool generate_source(const char *file_name, const int label_num)
+{
+    assert(file_name != nullptr);
+
+    FILE *stream = fopen(file_name, "w");
+    if (stream == nullptr) return false;
+
+    fprintf(stream, "jmp mark_0\n");
+
+    for (int mark_cnt = 0; mark_cnt < label_num; ++mark_cnt)
+    {
+        int target = (int) (((long long) mark_cnt * 7919 + 1) % label_num);
+
+        fprintf(stream, "mark_%d:\n"
+                        "    push %d\n"
+                        "    pop rex\n"
+                        "    jmp mark_%d\n", mark_cnt, mark_cnt, target);
+    }
+    fprintf(stream, "hlt\n");
+
+    fclose(stream);
+    return true;
+}
+
+double get_time()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <thread>
+
+#include "read_write.h"
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+const int    CMD_SIZE    = 301;
+const int    SRC_MB      = 256;
+const int    MAX_SRC_MB  = 2000;        // positions in "Asm2" are int
+const int    FRAME_PIXEL = 4096;        // arguments of "push_many" in a frame
+const int    LINE_PIXEL  = 16;          // arguments in a line
+const char  *SRC_FILE    = "asm_par_bench.asm";
+const char  *REF_FILE    = "asm_par_bench_1.cpu";
+const char  *EXE_FILE    = "asm_par_bench.cpu";
+
+/*---------------------------------------------------------*/
+
+bool   generate_source (const char *file_name, const size_t src_size);
+bool   is_same_file    (const char *fst_name, const char *sec_name);
+double get_time        ();
+
+/*---------------------------------------------------------*/
+
+/**
+*   @brief Measures "./Asm2 -j THREADS" on the generated source like the one of "make2" for 1, 2, ... THREADS threads.
+*   @brief Every frame is a mark, "push_many" with lines of colors, "pop_many" with lines of addresses and a jump to the next frame.
+*   @brief The machine code of every number of threads is compared with the one of 1 thread.
+*
+*   Usage: ./asm_par_bench [size of the source in MB] [max number of threads] [assembler]
+*/
+
+int main(int argc, const char *argv[])
+{
+    int         src_mb     = (argc > 1) ? atoi(argv[1]) : SRC_MB;
+    int         thread_num = (argc > 2) ? atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+    const char *asm_name   = (argc > 3) ? argv[3]       : "./Asm2";
+
+    if (src_mb     <= 0 || src_mb > MAX_SRC_MB) src_mb     = SRC_MB;
+    if (thread_num <= 0)                        thread_num = 1;
+
+    if (!generate_source(SRC_FILE, (size_t) src_mb << 20))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\"\n", SRC_FILE);
+        return 1;
+    }
+
+    double one_sec = 0;
+
+    for (int thread_cnt = 1; thread_cnt <= thread_num; ++thread_cnt)
+    {
+        const char *out_file = (thread_cnt == 1) ? REF_FILE : EXE_FILE;
+
+        char cmd[CMD_SIZE] = "";
+        snprintf(cmd, CMD_SIZE, "%s -j %d %s %s 2>/dev/null", asm_name, thread_cnt, SRC_FILE, out_file);
+
+        double start  = get_time();
+        int    status = system(cmd);
+        double sec    = get_time() - start;
+
+        if (status != 0)
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "\"%s\" failed\n", cmd);
+            return 1;
+        }
+        if (thread_cnt == 1) one_sec = sec;
+        else if (!is_same_file(REF_FILE, EXE_FILE))
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "The machine code of %d threads differs from the one of 1 thread\n", thread_cnt);
+            return 1;
+        }
+
+        printf("%d MB, %2d threads: %7.3f s, %6.1f MB/s, x%.2f\n", src_mb, thread_cnt, sec, (double) src_mb / sec, one_sec / sec);
+    }
+
+    return 0;
+}
+
+bool generate_source(const char *file_name, const size_t src_size)
+{
+    assert(file_name != nullptr);
+
+    FILE *stream = fopen(file_name, "w");
+    if (stream == nullptr) return false;
+
+    size_t cur_size  = 0;
+    int    frame_cnt = 0;
+
+    while (cur_size < src_size)
+    {
+        int len = fprintf(stream, "frame_%d:\n"
+                                  "    push_many %d\n", frame_cnt, FRAME_PIXEL);
+
+        for (int pixel_cnt = 0; pixel_cnt < FRAME_PIXEL; ++pixel_cnt)
+        {
+            len += fprintf(stream, (pixel_cnt % LINE_PIXEL == LINE_PIXEL - 1) ? "%u\n" : "%u ", (pixel_cnt * 2654435761u + frame_cnt) % 16777216);
+        }
+
+        len += fprintf(stream, "    pop_many %d\n", FRAME_PIXEL);
+
+        for (int pixel_cnt = 0; pixel_cnt < FRAME_PIXEL; ++pixel_cnt)
+        {
+            len += fprintf(stream, (pixel_cnt % LINE_PIXEL == LINE_PIXEL - 1) ? "%d\n" : "%d ", pixel_cnt);
+        }
+
+        len += fprintf(stream, "    jmp frame_%d\n", frame_cnt + 1);
+
+        cur_size += (size_t) len;
+        ++frame_cnt;
+    }
+    fprintf(stream, "frame_%d:\n"
+                    "hlt\n", frame_cnt);
+
+    fclose(stream);
+    return true;
+}
+
+bool is_same_file(const char *fst_name, const char *sec_name)
+{
+    assert(fst_name != nullptr);
+    assert(sec_name != nullptr);
+
+    size_t      fst_size = 0;
+    size_t      sec_size = 0;
+    const void *fst      = map_file(fst_name, &fst_size);
+    const void *sec      = map_file(sec_name, &sec_size);
+
+    bool is_same = (fst != nullptr && sec != nullptr && fst_size == sec_size && !memcmp(fst, sec, fst_size));
+
+    if (fst != nullptr) unmap_file(fst, fst_size);
+    if (sec != nullptr) unmap_file(sec, sec_size);
+
+    return is_same;
+}
+
+double get_time()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
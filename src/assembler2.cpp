@@ -6,35 +6,136 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
 
 #define RED    "\e[1;31m"
 #define CANCEL "\e[0m"
 #define GREEN  "\e[0;32m"
 
+/*
+ * Reports an error of the source. Errors of the parts assembled by threads are not reported:
+ * the source is assembled again by one thread then, so errors are reported in order and with line numbers.
+ */
+
+#define ASM_ERROR(program, ...)                                     \
+        do                                                          \
+        {                                                           \
+            if (!(program)->is_part) fprintf(stderr, __VA_ARGS__);  \
+        }                                                           \
+        while (0)
+
 #include "read_write.h"
 #include "tag.h"
 #include "machine.h"
+#include "mnemonic.h"
+#include "lexer.h"
+#include "decode.h"
+#include "optimize.h"
+#include "gdz.h"
 
 struct source
 {
-    char  *src_code;
-    size_t src_size; 
+    const char *src_code;       // mapped source file
+    size_t      src_size; 
+    size_t      dropped_size;   // size of the read part of the source whose pages are dropped from memory
+
+    size_t      part_end;       // commands are read up to this position: "src_size" or the end of the part assembled by a thread
+    size_t      part_need;      // number of "push_many", "pop_many" or "blit" arguments which are after "part_end"
+    bool        is_part;        // errors are not reported and all jumps are fixups, see "assembler_parallel()"
 };
 
 struct src_location
 {
-    int cur_src_pos;
-    int cur_src_line;
+    size_t cur_src_pos;
+    int    cur_src_line;
+
+    const char *cur_src_cmd;    // last read command or argument: view of the source, not null-terminated
+    int         cur_src_len;
+};
+
+/*
+ * Machine code written by the assembler. It is streamed to "out_fd" by blocks of "capacity" bytes,
+ * if the output is not a regular file the whole machine code is kept in "machine_code" instead.
+ */
+
+struct machine_stream
+{
+    char  *machine_code;        // bytes of the machine code which are not written yet
+    size_t capacity;
+
+    int    machine_pos;         // position of the next byte in the whole machine code (header included)
+    int    flushed_pos;         // position of "machine_code[0]" in the whole machine code
+
+    int    out_fd;
+    bool   is_stream;
+    bool   is_error;            // writing to "out_fd" failed
+};
+
+/*
+ * Jump to the mark which is not met yet. Its argument is patched when the whole source is read.
+ */
+
+struct fixup
+{
+    const char *mark_ptr;       // name of the mark in the source
+    int         mark_size;
 
-    char *cur_src_cmd;
+    int machine_pos;            // position of the jump argument in "machine code"
+    int src_line;
 };
 
-enum MARK
+struct fixup_list
 {
-    MARK_GET   , // 0
-    MARK_CHECK   // 1
+    fixup *data;
+
+    size_t size;
+    size_t capacity;
 };
 
+/*
+ * Part of the source assembled by a thread of "assembler_parallel()". It starts at the beginning of a line and can start
+ * in the middle of the "push_many", "pop_many" or "blit" arguments, so the leading integers are read before the commands.
+ */
+
+struct part
+{
+    source         program;
+    machine_stream cpu;         // machine code of the part, positions are counted from the beginning of the part
+    tag            label;
+    fixup_list     fixups;
+
+    size_t begin;
+    size_t first_pos;           // position of the first non-space character from "begin"
+    size_t lead_num;            // number of the leading integers
+    bool   is_lead_to_end;      // the leading integers fill the whole part
+    size_t end_pos;             // position of the first command after the part
+    bool   is_ok;
+};
+
+struct asm_options
+{
+    const char *src_file;
+    const char *out_file;
+
+    int  thread_num;
+    bool is_optimized;          // "-O": the machine code is optimized by "recode_machine()"
+    int  inline_budget;         // commands which "-O" can add by inlining
+    char version;               // version of the written machine code, "--v3": it is recoded by "recode_machine()"
+    bool is_packed;             // "--lz": the machine code is written in the compressed container by "pack_machine()"
+};
+
+const size_t LONG_BATCH       = 256;       // number of "push_many", "pop_many" and "blit" arguments read by the lexer at once
+const size_t MACHINE_BUF_SIZE = 1 << 16;   // block of the machine code written to the file at once
+const size_t SRC_DROP_SIZE    = 1 << 22;   // the read part of the source is dropped from memory by blocks of this size
+const size_t PART_MIN_SIZE    = 1 << 20;   // the source is split in parts not smaller than this
+const int    PART_PER_THREAD  = 4;         // parts are taken by threads one by one, so the threads finish at almost the same time
+const int    INLINE_BUDGET    = 1024;      // commands which "-O" can add by inlining by default
+const char   ASM_VERSION      = 2;         // version of the machine code made by the assembler
+
 const int REG_NUM = 8;
 const char *reg_names[] = 
 {
@@ -53,27 +154,52 @@ const char *reg_names[] =
 
 /*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
 
-CMD   identify_cmd          (const char *cmd);
+CMD   identify_cmd          (const char *cmd, const int len);
 
-bool  read_push_pop_arg     (source *const program, src_location *const info, machine *const cpu, unsigned char cmd);
-bool  cmd_pop               (source *const program, src_location *const info, machine *const cpu);
-bool  cmd_jmp               (source *const program, src_location *const info, machine *const cpu, tag *const label, const char mark_mode, unsigned char cmd);
-bool  get_mark              (source *const program, src_location *const info, machine *const cpu, tag *const label, int possible_mrk_beg, const char mark_mode);
-bool push_many              (source *const program, src_location *const info, machine *const cpu, unsigned char cmd);
-bool pop_many               (source *const program, src_location *const info, machine *const cpu, unsigned char cmd);
+bool  read_push_pop_arg     (source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd);
+bool  cmd_pop               (source *const program, src_location *const info, machine_stream *const cpu);
+bool  cmd_jmp               (source *const program, src_location *const info, machine_stream *const cpu, tag *const label, fixup_list *const fixups, unsigned char cmd);
+bool  get_mark              (source *const program, src_location *const info, machine_stream *const cpu, tag *const label, size_t possible_mrk_beg);
+bool  resolve_fixups        (machine_stream *const cpu, tag *const label, const fixup_list *const fixups);
+void  fixup_push            (fixup_list *const fixups, const fixup push_val);
+bool push_many              (source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd);
+bool pop_many               (source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd);
+bool blit                   (source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd);
+bool add_many_longs         (source *const program, src_location *const info, machine_stream *const cpu, size_t number);
 
 bool  is_comment            (source *const program, src_location *const info);
 bool  is_double             (const char *s, double *const val);
-bool  is_long               (const char *s, long   *const val);
-bool  is_reg                (const char *s, char   *const pos);
-bool  is_long_reg           (const char *s, char   *const pos);
+bool  is_long               (const char *s, const int len, long *const val);
+bool  is_reg                (const char *s, const int len, char *const pos);
+bool  is_long_reg           (const char *s, const int len, char *const pos);
 
-int   read_val              (source *program, src_location *info, const char sep1, const char sep2 = ' ');
+size_t read_val             (source *program, src_location *info, const char sep1, const char sep2 = ' ');
 
 void  tag_ctor              (tag *const label);
-void  add_machine_cmd       (machine *const cpu, const size_t val_size, void *val_ptr);
+void  tag_dtor              (tag *const label);
+bool  machine_ctor          (machine_stream *const cpu, const char *output_file);
+void  machine_dtor          (machine_stream *const cpu);
+void  add_machine_cmd       (machine_stream *const cpu, const size_t val_size, void *val_ptr);
+void  add_machine_block     (machine_stream *const cpu, const size_t size, void *data);
+void  machine_reserve       (machine_stream *const cpu, const size_t val_size);
+void  patch_machine_cmd     (machine_stream *const cpu, const int pos, const size_t val_size, const void *val_ptr);
+bool  machine_flush         (machine_stream *const cpu);
+void  machine_write         (machine_stream *const cpu, const void *data, const size_t size, const int pos);
+void  machine_read          (machine_stream *const cpu, void *data, const size_t size, const int pos);
 void  skip_spaces           (source *const program, src_location *const info);
-void *assembler             (source *program, size_t *const cpu_size, tag *const label, const char mark_mode);
+void  drop_read_source      (source *const program, const src_location *const info);
+bool  assembler             (source *program, machine_stream *const cpu, tag *const label);
+bool  assemble_commands     (source *program, src_location *const info, machine_stream *const cpu, tag *const label, fixup_list *const fixups);
+bool  assembler_parallel    (const source *program, machine_stream *const cpu, tag *const label, const int thread_num);
+void  assemble_parts        (part *const parts, const size_t part_num, std::atomic<size_t> *const next_part);
+void  assemble_part         (part *const cur);
+bool  link_parts            (part *const parts, const size_t part_num, machine_stream *const cpu, tag *const label);
+bool  parse_options         (int argc, const char *argv[], asm_options *const options);
+bool  recode_machine        (machine_stream *const cpu, tag *const label, const asm_options *const options);
+bool  pack_machine          (machine_stream *const cpu, const char *output_file);
+void  print_inlines         (const opt_report *report, const tag *label, const int *mark_of_cmd);
+void  print_report          (const opt_report *report, const int cmd_num, const int old_size, const int new_size);
+int   find_pos_index        (const int *cmd_pos, const int cmd_num, const int machine_pos);
 void *make_wrong_signature  ();
 void  write_wrong_signature (const char *output_file);
 
@@ -81,124 +207,665 @@ void  write_wrong_signature (const char *output_file);
 
 int main(int argc, const char *argv[])
 {
-    source program  = {};
-    program.src_code  = (char *) read_file(argv[1], &program.src_size);
+    asm_options options = {};
+    if (!parse_options(argc, argv, &options)) return 1;
 
-    void *machine_data = nullptr;
+    source program  = {};
+    program.src_code  = (const char *) map_file(options.src_file, &program.src_size);
+    program.part_end  = program.src_size;
 
     if (program.src_code == nullptr)
     {
-        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\"\n", argv[1]);
-        write_wrong_signature(argv[2]);
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\"\n", options.src_file);
+        write_wrong_signature(options.out_file);
         return 1;
     }
 
-    tag label = {};
-    tag_ctor(&label);
+    bool is_recoded = options.is_optimized || options.version != ASM_VERSION;
 
-    header machine_info = {'G', 'D', 2, 0};
-
-    if ((machine_data = assembler(&program, &machine_info.cmd_num, &label, MARK_GET  )) == nullptr)
+    machine_stream cpu = {};
+    if (!machine_ctor(&cpu, (is_recoded || options.is_packed) ? nullptr : options.out_file))
     {
-        write_wrong_signature(argv[2]);
+        unmap_file(program.src_code, program.src_size);
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file to write the machine code in\n");
         return 1;
     }
-    if ((machine_data = assembler(&program, &machine_info.cmd_num, &label, MARK_CHECK)) == nullptr)
+
+    tag label = {};
+    tag_ctor(&label);
+
+    header machine_info = {};
+    memset(&machine_info, 0, sizeof(header));   // padding of the header is written too
+    add_machine_cmd(&cpu, sizeof(header), &machine_info);
+
+    bool is_ok = (options.thread_num > 1 && assembler_parallel(&program, &cpu, &label, options.thread_num)) ||
+                  assembler(&program, &cpu, &label);
+
+    if (is_ok && is_recoded) is_ok = recode_machine(&cpu, &label, &options);
+
+    if (is_ok)
     {
-        write_wrong_signature(argv[2]);
-        return 1;
+        machine_info.fst_let = 'G';
+        machine_info.sec_let = 'D';
+        machine_info.version = options.version;
+        machine_info.cmd_num = (size_t) cpu.machine_pos - sizeof(header); //only machine commands (without header)
+
+        patch_machine_cmd(&cpu, 0, sizeof(header), &machine_info);
+
+        if (options.is_packed) is_ok = pack_machine(&cpu, options.out_file);
+
+        if (is_ok && !machine_flush(&cpu))
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "Can't write the machine code in the file\n");
+            is_ok = false;
+        }
     }
 
-    *(header *) machine_data = machine_info;
+    machine_dtor(&cpu);
+    tag_dtor(&label);
+    unmap_file(program.src_code, program.src_size);
 
-    if (write_file(argv[2], machine_data, machine_info.cmd_num + sizeof(header)) == false)
+    if (!is_ok)
     {
-        free(machine_data);
-        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file to write the machine code in\n");
+        write_wrong_signature(options.out_file);
         return 1;
     }
 
-    free(machine_data);
     fprintf(stderr, GREEN "./ASM2 IS OK\n" CANCEL);
     return 0;
 }
 
+bool parse_options(int argc, const char *argv[], asm_options *const options)
+{
+    assert(argv    != nullptr);
+    assert(options != nullptr);
+
+    *options = {nullptr, nullptr, 1, false, INLINE_BUDGET, ASM_VERSION, false};
+
+    for (int arg_cnt = 1; arg_cnt < argc; ++arg_cnt)
+    {
+        if (!strcmp(argv[arg_cnt], "-j") && arg_cnt + 1 < argc)
+        {
+            options->thread_num = atoi(argv[++arg_cnt]);
+            if (options->thread_num < 1) options->thread_num = 1;
+        }
+        else if (!strcmp(argv[arg_cnt], "-O"  )) options->is_optimized = true;
+        else if (!strcmp(argv[arg_cnt], "--v3")) options->version      = 3;
+        else if (!strcmp(argv[arg_cnt], "--lz")) options->is_packed    = true;
+        else if (!strcmp(argv[arg_cnt], "--inline-budget") && arg_cnt + 1 < argc)
+        {
+            options->inline_budget = atoi(argv[++arg_cnt]);
+            if (options->inline_budget < 0) options->inline_budget = 0;
+        }
+        else if (!strcmp(argv[arg_cnt], "--help"))
+        {
+            fprintf(stderr, "usage: ./Asm2 [-j THREADS] [-O [--inline-budget COMMANDS]] [--v3] [--lz] SRC_FILE EXE_FILE\n"
+                            "       -j              - assemble parts of SRC_FILE by THREADS threads, the machine code is the same as by one thread\n"
+                            "       -O              - inline small routines, replace \"call\" followed by \"ret\" by \"jmp\", propagate constants\n"
+                            "                         in registers, remove dead \"pop reg\" and unreachable commands, fold constant arithmetic\n"
+                            "                         and jumps, remove \"push / pop\" pairs and jumps to the next command, retarget jumps to \"jmp\",\n"
+                            "                         the numbers of commands and bytes and inlining decisions are printed\n"
+                            "       --inline-budget - maximal number of commands added by inlining (%d by default)\n"
+                            "       --v3            - write GD v3: arguments are varints, jumps are relative (see \"decode.h\"),\n"
+                            "                         the sizes of the machine code in v2 and v3 are printed\n"
+                            "       --lz            - write the machine code compressed by blocks (see \"gdz.h\"), ./CPU executes it\n"
+                            "                         while the next blocks are decompressed, the sizes before and after are printed\n", INLINE_BUDGET);
+            return false;
+        }
+        else if (argv[arg_cnt][0] != '-' && options->src_file == nullptr) options->src_file = argv[arg_cnt];
+        else if (argv[arg_cnt][0] != '-' && options->out_file == nullptr) options->out_file = argv[arg_cnt];
+        else
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "Unknown argument \"%s\"\n"
+                            "print \"./Asm2 --help\"\n", argv[arg_cnt]);
+            return false;
+        }
+    }
+
+    if (options->out_file == nullptr)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "There are no source and machine code files\n"
+                        "print \"./Asm2 --help\"\n");
+        return false;
+    }
+
+    return true;
+}
+
 /**
-*   @brief Translates "source code" to "machine code".
+*   @brief Decodes the machine code assembled in memory, optimizes it by "optimize_program()" if "-O" is given, encodes it
+*   @brief in "options->version" and moves it to the new "cpu" which writes to "options->out_file".
+*   @brief Marks get their positions in the new machine code.
+*   @brief Prints the numbers of commands and bytes before and after and decisions about inlining of every routine in stderr.
+*
+*   @param cpu     [in][out] - machine code with the header which is not patched yet
+*   @param label   [in][out] - marks of the machine code
+*   @param options [in]      - options of "./Asm2"
+*
+*   @return true if the machine code is recoded and false else
+*/
+
+bool recode_machine(machine_stream *const cpu, tag *const label, const asm_options *const options)
+{
+    assert(cpu     != nullptr);
+    assert(label   != nullptr);
+    assert(options != nullptr);
+
+    decoded program = {};
+    if (!decode_program(cpu->machine_code, (size_t) cpu->machine_pos, ASM_VERSION, &program)) return false;
+
+    int cmd_num = program.size;
+
+    int *old_pos     = (int *) calloc(cmd_num + 1, sizeof(int));
+    int *cmd_map     = (int *) calloc(cmd_num + 1, sizeof(int));
+    int *mark_of_cmd = (int *) calloc(cmd_num + 1, sizeof(int));
+    assert(old_pos     != nullptr);
+    assert(cmd_map     != nullptr);
+    assert(mark_of_cmd != nullptr);
+
+    int old_size = encode_layout(&program, ASM_VERSION, sizeof(header), old_pos);
+    for (int cmd_cnt = 0; cmd_cnt <= cmd_num; ++cmd_cnt)
+    {
+        cmd_map    [cmd_cnt] = cmd_cnt;
+        mark_of_cmd[cmd_cnt] = -1;
+    }
+    for (size_t mark_cnt = 0; mark_cnt < label->size; ++mark_cnt)
+    {
+        mark_of_cmd[find_pos_index(old_pos, cmd_num + 1, label->data[mark_cnt].machine_pos)] = (int) mark_cnt;
+    }
+
+    opt_report report = {};
+
+    if (options->is_optimized) optimize_program(&program, cmd_map, cmd_num + 1, options->inline_budget, &report);
+
+    int *new_pos  = (int *) calloc(program.size + 1, sizeof(int));
+    assert(new_pos != nullptr);
+
+    int  opt_size = encode_layout(&program, ASM_VERSION, sizeof(header), new_pos);
+    int  new_size = (options->version == ASM_VERSION) ? opt_size : encode_layout(&program, options->version, sizeof(header), new_pos);
+
+    if (options->is_optimized) print_inlines(&report, label, mark_of_cmd);
+
+    for (size_t mark_cnt = 0; mark_cnt < label->size; ++mark_cnt)
+    {
+        mark *cur = label->data + mark_cnt;
+        cur->machine_pos = new_pos[cmd_map[find_pos_index(old_pos, cmd_num + 1, cur->machine_pos)]];
+    }
+
+    char *code = (char *) calloc(new_size, sizeof(char));
+    assert(code != nullptr);
+
+    memcpy(code, cpu->machine_code, sizeof(header));
+    encode_program(&program, options->version, new_pos, code);
+
+    machine_stream out = {};
+    bool is_opened = machine_ctor(&out, options->is_packed ? nullptr : options->out_file);
+
+    if (is_opened)
+    {
+        add_machine_block(&out, (size_t) new_size, code);
+
+        if (options->is_optimized)           print_report(&report, program.size, old_size, opt_size);
+        if (options->version != ASM_VERSION) fprintf(stderr, "--v3: %d -> %d bytes (%.1f%%)\n", opt_size, new_size, 100.0 * new_size / opt_size);
+
+        machine_dtor(cpu);
+        *cpu = out;
+    }
+    else fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file to write the machine code in\n");
+
+    free(code);
+    free(new_pos);
+    free(cmd_map);
+    free(old_pos);
+    free(mark_of_cmd);
+    opt_report_dtor(&report);
+    decode_dtor(&program);
+
+    return is_opened;
+}
+
+/**
+*   @brief Packs the machine code kept in memory by "gdz_pack()" and moves the container to the new "cpu" which writes to "output_file".
+*   @brief Prints the sizes of the machine code and of the container in stderr.
+*
+*   @param cpu         [in][out] - machine code with the patched header
+*   @param output_file [in]      - name of the file to write the container in
+*
+*   @return true if the machine code is packed and false else
+*/
+
+bool pack_machine(machine_stream *const cpu, const char *output_file)
+{
+    assert(cpu         != nullptr);
+    assert(output_file != nullptr);
+
+    header machine_info = {};
+    memcpy(&machine_info, cpu->machine_code, sizeof(header));
+
+    void  *container      = nullptr;
+    size_t container_size = 0;
+
+    if (!gdz_pack(cpu->machine_code, (size_t) cpu->machine_pos, machine_info.version, &container, &container_size))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't pack the machine code\n");
+        return false;
+    }
+
+    machine_stream out = {};
+    bool is_opened = machine_ctor(&out, output_file);
+
+    if (is_opened)
+    {
+        add_machine_block(&out, container_size, container);
+        fprintf(stderr, "--lz: %d -> %zu bytes (%.1f%%)\n", cpu->machine_pos, container_size, 100.0 * (double) container_size / cpu->machine_pos);
+
+        machine_dtor(cpu);
+        *cpu = out;
+    }
+    else fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file to write the machine code in\n");
+
+    free(container);
+    return is_opened;
+}
+
+/**
+*   @brief Prints the numbers of commands and bytes before and after the optimizations and the numbers of applied optimizations in stderr.
+*
+*   @param report   [in] - report of the optimizations
+*   @param cmd_num  [in] - number of commands after the optimizations
+*   @param old_size [in] - size of the machine code before the optimizations
+*   @param new_size [in] - size of the machine code after the optimizations
+*/
+
+void print_report(const opt_report *report, const int cmd_num, const int old_size, const int new_size)
+{
+    assert(report != nullptr);
+
+    fprintf(stderr, "-O: %d -> %d commands (%+d), %d -> %d bytes (%+d)\n"
+                    "    %d commands added by inlining, %d tail calls, %d registers replaced by constants, %d dead \"pop reg\",\n"
+                    "    %d unreachable commands, %d folded, %d folded jumps, %d push/pop pairs, %d jumps to the next command, %d jump chains\n",
+                    report->cmd_num, cmd_num, cmd_num - report->cmd_num, old_size, new_size, new_size - old_size,
+                    report->inline_added, report->tail_calls, report->const_regs, report->dead_pops,
+                    report->unreachable, report->folded, report->jcc_folded, report->push_pop, report->jmp_next, report->jmp_chains);
+}
+
+/**
+*   @brief Prints decisions about inlining of every routine in stderr. Routines are named by their marks.
+*
+*   @param report      [in] - report of the optimizations
+*   @param label       [in] - marks with positions before the optimizations
+*   @param mark_of_cmd [in] - index of the mark of every command or -1
+*/
+
+void print_inlines(const opt_report *report, const tag *label, const int *mark_of_cmd)
+{
+    assert(report      != nullptr);
+    assert(label       != nullptr);
+    assert(mark_of_cmd != nullptr);
+
+    for (int inline_cnt = 0; inline_cnt < report->inline_num; ++inline_cnt)
+    {
+        const opt_inline *cur = report->inlines + inline_cnt;
+        int               mrk = mark_of_cmd[cur->target];
+
+        if (mrk != -1) fprintf(stderr, "-O: inline \"%.*s\"", label->data[mrk].mark_size, label->data[mrk].mark_ptr);
+        else           fprintf(stderr, "-O: inline the command %d", cur->target);
+
+        if (cur->size != 0) fprintf(stderr, " (%d commands, %d calls): %d inlined", cur->size, cur->call_num, cur->inlined_num);
+        else                fprintf(stderr, " (%d calls): %d inlined",                          cur->call_num, cur->inlined_num);
+
+        if (cur->reason != nullptr) fprintf(stderr, ", %s\n", cur->reason);
+        else                        fprintf(stderr, "\n");
+    }
+}
+
+/**
+*   @brief Finds the first command which is not before "machine_pos" using binary search.
+*
+*   @param cmd_pos     [in] - sorted positions of commands
+*   @param cmd_num     [in] - number of positions
+*   @param machine_pos [in] - position to find
+*
+*   @return index of the command, "cmd_num - 1" if all the commands are before "machine_pos"
+*/
+
+int find_pos_index(const int *cmd_pos, const int cmd_num, const int machine_pos)
+{
+    assert(cmd_pos != nullptr);
+
+    int left  = 0;
+    int right = cmd_num - 1;
+
+    while (left < right)
+    {
+        int mid = (left + right) / 2;
+
+        if (cmd_pos[mid] < machine_pos) left  = mid + 1;
+        else                            right = mid;
+    }
+
+    return left;
+}
+
+/**
+*   @brief Translates "source code" to "machine code". The machine code is added after the header already in "cpu".
 *
 *   @param program   [in]  - pointer to the structure with information about source
-*   @param cpu_size  [out] - pointer to the variable to put the size of "machine code" (in bytes) in
+*   @param cpu       [out] - pointer to the struct "machine_stream" to add the machine code in
 *   @param label     [out] - pointer to the "tag" variable to put marks in
-*   @param mark_mode [in]  - mode of cmd-jump module
 *
-*   @return array consisting of "machine code" 
+*   @return true if the source is correct and false else
 */
 
-void *assembler(source *program, size_t *const cpu_size, tag *const label, const char mark_mode)
+bool assembler(source *program, machine_stream *const cpu, tag *const label)
 {
     assert(program != nullptr);
+    assert(cpu     != nullptr);
+
+    src_location info = {0, 1, program->src_code, 0};
+
+    fixup_list fixups = {};
+
+    bool error = !assemble_commands(program, &info, cpu, label, &fixups);
 
-    src_location info = {0, 1, (char *) calloc(sizeof(char), program->src_size + 1)};
-    assert(info.cur_src_cmd != nullptr);
+    if (!resolve_fixups(cpu, label, &fixups)) error = true;
+
+    free(fixups.data);
+
+    return !error;
+}
+
+/**
+*   @brief Translates commands from "info->cur_src_pos" up to "program->part_end". The last command can end after "program->part_end".
+*
+*   @param program [in]      - pointer to the structure with information about source
+*   @param info    [in][out] - pointer to the structure with information abour location in source
+*   @param cpu     [out]     - pointer to the struct "machine_stream" to add the machine code in
+*   @param label   [in][out] - pointer to the store of marks
+*   @param fixups  [out]     - pointer to the list of jumps to marks which are not met yet
+*
+*   @return true if the commands are correct and false else
+*/
 
-    machine cpu = { calloc(sizeof(double), program->src_size), sizeof(header) };
-    assert( cpu.machine_code != nullptr);
+bool assemble_commands(source *program, src_location *const info, machine_stream *const cpu, tag *const label, fixup_list *const fixups)
+{
+    assert(program != nullptr);
+    assert(info    != nullptr);
+    assert(cpu     != nullptr);
 
     bool error = false;
-    skip_spaces(program, &info);
+    skip_spaces(program, info);
 
-    while (info.cur_src_pos < program->src_size)
+    while (info->cur_src_pos < program->part_end)
     {
-        int possible_mark_begin = read_val(program, &info, ':');
-        CMD status_cmd = identify_cmd(info.cur_src_cmd);
+        size_t possible_mark_begin = read_val(program, info, ':');
+        CMD status_cmd = identify_cmd(info->cur_src_cmd, info->cur_src_len);
 
         switch (status_cmd)
         {
             case CMD_NOT_EXICTING:
-                if (is_comment(program, &info))                                              break;
-                if (get_mark  (program, &info, &cpu, label, possible_mark_begin, mark_mode)) break;
+                if (is_comment(program, info))                                              break;
+                if (get_mark  (program, info, cpu, label, possible_mark_begin)) break;
                 
                 error = true;
                 break;
 
             case CMD_PUSH:
-                if (!read_push_pop_arg(program, &info, &cpu, CMD_PUSH)) error = true;
+                if (!read_push_pop_arg(program, info, cpu, CMD_PUSH)) error = true;
                 break;
 
             case CMD_POP:
-                if (!cmd_pop(program, &info, &cpu)) error = true;
+                if (!cmd_pop(program, info, cpu)) error = true;
                 break;
 
             case CMD_JMP: case CMD_JA: case CMD_JAE: case CMD_JB:
             case CMD_JBE: case CMD_JE: case CMD_JNE: case CMD_CALL:
-                if (!cmd_jmp(program, &info, &cpu, label, mark_mode, status_cmd)) error = true;
+                if (!cmd_jmp(program, info, cpu, label, fixups, status_cmd)) error = true;
                 break;
 
             case CMD_PUSH_MANY:
-                if (!push_many(program, &info, &cpu, status_cmd)) error = true;
+                if (!push_many(program, info, cpu, status_cmd)) error = true;
+                break;
+
+            case CMD_POP_MANY:
+                if (!pop_many(program, info, cpu,  status_cmd)) error = true;
                 break;
 
-            case CMD_POP_MANY:
-                if (!pop_many(program, &info, &cpu,  status_cmd)) error = true;
-                break;
+            case CMD_BLIT:
+                if (!blit(program, info, cpu, status_cmd)) error = true;
+                break;
+
+            default:
+                add_machine_cmd(cpu, sizeof(char), &status_cmd);
+                break;
+        }
+        if (program->part_need != 0) break;     // the arguments are continued in the next part
+
+        skip_spaces     (program, info);
+        drop_read_source(program, info);
+    }
+
+    return !error;
+}
+
+/**
+*   @brief Translates "source code" to "machine code" by "thread_num" threads. The source is split in parts at the beginnings of lines,
+*   @brief every part is translated separately with its own marks, then the parts are linked: they are checked to be split between commands
+*   @brief or between arguments of "push_many" and "pop_many", marks get positions in the whole machine code and jumps are patched.
+*   @brief The machine code is the same as the one of "assembler()".
+*
+*   @param program    [in]  - pointer to the structure with information about source
+*   @param cpu        [out] - pointer to the struct "machine_stream" to add the machine code in
+*   @param label      [out] - empty mark table to put the marks of the whole program in, it stays empty if false is returned
+*   @param thread_num [in]  - number of threads
+*
+*   @return true if the source is translated and false if it is to be translated by "assembler()":
+*   @return it is small, or there is an error, or a command is split between parts
+*/
+
+bool assembler_parallel(const source *program, machine_stream *const cpu, tag *const label, const int thread_num)
+{
+    assert(program != nullptr);
+    assert(cpu     != nullptr);
+    assert(label   != nullptr);
+
+    size_t part_num = (size_t) thread_num * PART_PER_THREAD;
+    if (program->src_size / part_num < PART_MIN_SIZE) part_num = program->src_size / PART_MIN_SIZE;
+    if (part_num < 2) return false;
+
+    part *parts = (part *) calloc(part_num, sizeof(part));
+    assert(parts != nullptr);
+
+    size_t begin = 0;
+
+    for (size_t part_cnt = 0; part_cnt < part_num; ++part_cnt)
+    {
+        size_t end = (part_cnt + 1 == part_num) ? program->src_size : program->src_size / part_num * (part_cnt + 1);
+        if    (end < begin) end = begin;
+
+        const char *line_end = (const char *) memchr(program->src_code + end, '\n', program->src_size - end);
+        if (end != program->src_size) end = (line_end == nullptr) ? program->src_size : (size_t) (line_end - program->src_code) + 1;
+
+        parts[part_cnt].begin             = begin;
+        parts[part_cnt].program           = *program;
+        parts[part_cnt].program.part_end  = end;
+        parts[part_cnt].program.part_need = 0;
+        parts[part_cnt].program.is_part   = true;
+
+        begin = end;
+    }
+
+    lex_best();     // the lexer is chosen before threads use it
+
+    std::atomic<size_t> next_part(0);
+    std::thread        *workers = new std::thread[thread_num];
+
+    for (int thread_cnt = 0; thread_cnt < thread_num; ++thread_cnt) workers[thread_cnt] = std::thread(assemble_parts, parts, part_num, &next_part);
+    for (int thread_cnt = 0; thread_cnt < thread_num; ++thread_cnt) workers[thread_cnt].join();
+
+    delete[] workers;
+
+    bool is_linked = link_parts(parts, part_num, cpu, label);
+
+    for (size_t part_cnt = 0; part_cnt < part_num; ++part_cnt)
+    {
+        machine_dtor(&parts[part_cnt].cpu);
+        tag_dtor    (&parts[part_cnt].label);
+        free        ( parts[part_cnt].fixups.data);
+    }
+    free(parts);
+
+    return is_linked;
+}
+
+/**
+*   @brief Takes parts one by one and translates them. It is executed by every thread of "assembler_parallel()".
+*/
+
+void assemble_parts(part *const parts, const size_t part_num, std::atomic<size_t> *const next_part)
+{
+    assert(parts     != nullptr);
+    assert(next_part != nullptr);
+
+    size_t part_cnt = 0;
+
+    while ((part_cnt = next_part->fetch_add(1)) < part_num) assemble_part(parts + part_cnt);
+}
+
+/**
+*   @brief Translates the part of the source: the leading integers (except in the first part), then commands.
+*
+*   @param cur [in][out] - pointer to the part
+*/
+
+void assemble_part(part *const cur)
+{
+    assert(cur != nullptr);
+
+    source      *program = &cur->program;
+    src_location info    = {cur->begin, 1, program->src_code, 0};
+
+    machine_ctor(&cur->cpu, nullptr);
+    tag_ctor    (&cur->label);
+
+    skip_spaces(program, &info);
+    cur->first_pos   = info.cur_src_pos;
+    info.cur_src_pos = cur->begin;
+
+    if (cur->begin != 0)
+    {
+        const lexer *lex = lex_best();
+        long vals[LONG_BATCH] = {};
+
+        size_t read_num = LONG_BATCH;
+
+        while (read_num == LONG_BATCH)
+        {
+            info.cur_src_pos = lex->read_longs(program->src_code, info.cur_src_pos, program->part_end, &info.cur_src_line, vals, &read_num);
+            add_machine_cmd(&cur->cpu, read_num * sizeof(long), vals);
+
+            cur->lead_num += read_num;
+        }
+        cur->is_lead_to_end = (info.cur_src_pos == program->part_end);
+    }
+
+    cur->is_ok   = assemble_commands(program, &info, &cur->cpu, &cur->label, &cur->fixups);
+    cur->end_pos = info.cur_src_pos;
+}
+
+/**
+*   @brief Checks that the parts are split between commands or between arguments of "push_many", "pop_many" and "blit".
+*   @brief Puts marks of all the parts in "label", patches jumps of the parts and adds the machine code of the parts in "cpu".
+*
+*   @param parts    [in][out] - translated parts
+*   @param part_num [in]      - number of parts
+*   @param cpu      [out]     - pointer to the struct "machine_stream" to add the machine code in
+*   @param label    [out]     - empty mark table, it is empty again if the parts aren't linked
+*
+*   @return true if the parts are linked and false else
+*/
+
+bool link_parts(part *const parts, const size_t part_num, machine_stream *const cpu, tag *const label)
+{
+    assert(parts != nullptr);
+    assert(cpu   != nullptr);
+    assert(label != nullptr);
+
+    size_t need     = 0;    // arguments of "push_many", "pop_many" or "blit" which are continued in the next part
+    size_t prev_end = 0;
+
+    for (size_t part_cnt = 0; part_cnt < part_num; ++part_cnt)
+    {
+        const part *cur = parts + part_cnt;
+        if (!cur->is_ok) return false;
+
+        if (need != 0)
+        {
+            if (cur->lead_num > need) return false;
+            if (cur->lead_num < need)
+            {
+                if (!cur->is_lead_to_end) return false;
+
+                need -= cur->lead_num;
+                continue;
+            }
+        }
+        else if (part_cnt != 0 && (cur->lead_num != 0 || cur->first_pos != prev_end)) return false;
+
+        need     = cur->program.part_need;
+        prev_end = cur->end_pos;
+    }
+    if (need != 0) return false;
+
+    bool is_linked = true;
+    int  base      = cpu->machine_pos;
+
+    for (size_t part_cnt = 0; part_cnt < part_num && is_linked; ++part_cnt)
+    {
+        const tag *part_label = &parts[part_cnt].label;
+
+        for (size_t mark_cnt = 0; mark_cnt < part_label->size && is_linked; ++mark_cnt)
+        {
+            mark cur = part_label->data[mark_cnt];
+            cur.machine_pos += base;
+
+            is_linked = tag_push(label, cur);
+        }
+        base += parts[part_cnt].cpu.machine_pos;
+    }
+
+    for (size_t part_cnt = 0; part_cnt < part_num && is_linked; ++part_cnt)
+    {
+        const fixup_list *fixups = &parts[part_cnt].fixups;
 
-            default:
-                add_machine_cmd(&cpu, sizeof(char), &status_cmd);
-                break;
+        for (size_t fixup_cnt = 0; fixup_cnt < fixups->size && is_linked; ++fixup_cnt)
+        {
+            const fixup *cur = fixups->data + fixup_cnt;
+
+            int label_pos = tag_mark_find(label, {(char *) cur->mark_ptr, cur->mark_size, 0});
+            if (label_pos == -1) is_linked = false;
+            else patch_machine_cmd(&parts[part_cnt].cpu, cur->machine_pos, sizeof(int), &label->data[label_pos].machine_pos);
         }
-        skip_spaces(program, &info);
     }
 
-    free(info.cur_src_cmd);
-    if (error) return nullptr;
+    if (!is_linked)
+    {
+        tag_dtor(label);    // "assembler()" fills the mark table again
+        tag_ctor(label);
+        return false;
+    }
 
-    *cpu_size = cpu.machine_pos - sizeof(header); //only machine commands (without header)
+    for (size_t part_cnt = 0; part_cnt < part_num; ++part_cnt)
+    {
+        add_machine_block(cpu, (size_t) parts[part_cnt].cpu.machine_pos, parts[part_cnt].cpu.machine_code);
+    }
 
-    return cpu.machine_code;
+    return true;
 }
 
 /**
-*   @brief Reads another command or argument from source and puts it in the array "info->cur_src_cmd". Skips all spaces before and after command.
+*   @brief Reads another command or argument from source: "info->cur_src_cmd" and "info->cur_src_len" point to it in the source.
+*   @brief Skips all spaces before command.
 *
 *   @param program [in]  - pointer   to the structure with information about source
 *   @param info    [out] - pointer   to the structure with information abour location in source
@@ -210,25 +877,24 @@ void *assembler(source *program, size_t *const cpu_size, tag *const label, const
 *   @note reading also stops after meeting a space-character
 */
 
-int read_val(source *program, src_location *info, const char sep1, const char sep2)
+size_t read_val(source *program, src_location *info, const char sep1, const char sep2)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
 
     skip_spaces(program, info);
     
-    int ans = info->cur_src_pos;
+    size_t ans = info->cur_src_pos;
     int cur_char = 0;
-    int cmd_counter = 0;
 
     while (info->cur_src_pos < program->src_size &&
            !isspace(cur_char = program->src_code[info->cur_src_pos]) && cur_char != sep1 && cur_char != sep2)
     {
-        info->cur_src_cmd[cmd_counter++] = cur_char;
         info->cur_src_pos++;
     }
-    
-    info->cur_src_cmd[cmd_counter] = '\0';
+
+    info->cur_src_cmd = program->src_code + ans;
+    info->cur_src_len = (int) (info->cur_src_pos - ans);
 
     return ans;
 }
@@ -236,28 +902,19 @@ int read_val(source *program, src_location *info, const char sep1, const char se
 /**
 *   @brief Identifies the command "cmd". Returns corresponding value from enum "CMD".
 *
-*   @param cmd [in] - pointer to the first byte of null-terminated byte string coding the command
+*   @param cmd [in] - pointer to the first byte of the command
+*   @param len [in] - length of the command
 *
 *   @return the value from enum "CMD" that corresponds to "cmd"
 *
 *   @note return "CMD_NOT_EXICTING" if command "cmd" is invalid
 */
 
-CMD identify_cmd(const char *cmd)
+CMD identify_cmd(const char *cmd, const int len)
 {
     assert(cmd != nullptr);
 
-    #define DEF_CMD(name, ...)                              \
-            if (!strcasecmp(cmd, #name)) return CMD_##name;
-    
-    #define DEF_JMP_CMD(name, ...)                          \
-            if (!strcasecmp(cmd, #name)) return CMD_##name;
-
-    #include "cmd.h"
-    #undef DEF_CMD
-    #undef DEF_JMP_CMD
-
-    return CMD_NOT_EXICTING;
+    return mnemonic_find(cmd, (size_t) len);
 }
 
 /**
@@ -265,12 +922,12 @@ CMD identify_cmd(const char *cmd)
 *
 *   @param program [in]  - pointer to the structure with information about source
 *   @param info    [in]  - pointer to the structure with information abour location in source
-*   @param cpu     [out] - pointer to the struct "machine" to add the command and arguments in "cpu->machine_code"
+*   @param cpu     [out] - pointer to the struct "machine_stream" to add the command and arguments in "cpu->machine_code"
 *
 *   @return true if arguments are correct and false else
 */
 
-bool cmd_pop(source *const program, src_location *const info, machine *const cpu)
+bool cmd_pop(source *const program, src_location *const info, machine_stream *const cpu)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
@@ -283,14 +940,14 @@ bool cmd_pop(source *const program, src_location *const info, machine *const cpu
 
     char reg_arg = 0;
     read_val(program, info, ' ');
-    if (!strcmp(info->cur_src_cmd, "void"))
+    if (info->cur_src_len == 4 && !strncmp(info->cur_src_cmd, "void", 4))
     {
         cmd = cmd | CMD_NUM_ARG;
         add_machine_cmd(cpu, sizeof(char), &cmd);
         
         return true;
     }
-    else if (is_reg(info->cur_src_cmd, &reg_arg) || is_long_reg(info->cur_src_cmd, &reg_arg))
+    else if (is_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg) || is_long_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg))
     {
         cmd = cmd | CMD_REG_ARG;
         add_machine_cmd(cpu, sizeof(char), &cmd);
@@ -299,11 +956,11 @@ bool cmd_pop(source *const program, src_location *const info, machine *const cpu
         return true;
     }
 
-    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid pop-argument\n", info->cur_src_line, info->cur_src_cmd);
+    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid pop-argument\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
     return false;
 }
 
-bool push_many(source *const program, src_location *const info, machine *const cpu, unsigned char cmd)
+bool push_many(source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
@@ -314,32 +971,21 @@ bool push_many(source *const program, src_location *const info, machine *const c
     long number = 0;
     read_val(program, info, ' ', ' ');
     
-    if (is_long(info->cur_src_cmd, &number))
+    if (is_long(info->cur_src_cmd, info->cur_src_len, &number) && number >= 0)
     {
         add_machine_cmd(cpu, sizeof(long), &number);
-        while (number--)
-        {
-            long val = 0;
-            read_val(program, info, ' ', ' ');
-
-            if (is_long(info->cur_src_cmd, &val)) add_machine_cmd(cpu, sizeof(long), &val);
-            else
-            {
-                fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid long-argument\n", info->cur_src_line, info->cur_src_cmd);
-                return false;
-            }
-        }
+        return add_many_longs(program, info, cpu, (size_t) number);
     }
     else
     {
-        fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid number of push-arguments\n", info->cur_src_line, info->cur_src_cmd);
+        ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid number of push-arguments\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
         return false;
     }
 
     return true;
 }
 
-bool pop_many(source *const program, src_location *const info, machine *const cpu, unsigned char cmd)
+bool pop_many(source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
@@ -350,38 +996,103 @@ bool pop_many(source *const program, src_location *const info, machine *const cp
     long number = 0;
     read_val(program, info, ' ', ' ');
 
-    if (is_long(info->cur_src_cmd, &number))
+    if (is_long(info->cur_src_cmd, info->cur_src_len, &number) && number >= 0)
     {
         add_machine_cmd(cpu, sizeof(long), &number);
-        while (number--)
-        {
-            long ram_index = 0;
-            read_val(program, info, ' ', ' ');
-
-            if (is_long(info->cur_src_cmd, &ram_index)) add_machine_cmd(cpu, sizeof(long), &ram_index);
-            else
-            {
-                fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid long-argument\n", info->cur_src_line, info->cur_src_cmd);
-                return false;
-            }
-        }
+        return add_many_longs(program, info, cpu, (size_t) number);
     }
     else
     {
-        fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid number of pop-arguments\n", info->cur_src_line, info->cur_src_cmd);
+        ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid number of pop-arguments\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
         return false;
     }
 
     return true;
 }
 
+/**
+*   @brief Reads "blit": the number of values and the values which are spans of RAM cells (see "decode.h").
+*   @brief The spans are checked by the decoder of "./CPU", the assembler only reads the numbers.
+*/
+
+bool blit(source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd)
+{
+    assert(program != nullptr);
+    assert(info    != nullptr);
+    assert(cpu     != nullptr);
+
+    add_machine_cmd(cpu, sizeof(char), &cmd);
+
+    long number = 0;
+    read_val(program, info, ' ', ' ');
+
+    if (is_long(info->cur_src_cmd, info->cur_src_len, &number) && number >= 0)
+    {
+        add_machine_cmd(cpu, sizeof(long), &number);
+        return add_many_longs(program, info, cpu, (size_t) number);
+    }
+
+    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid number of blit-arguments\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
+    return false;
+}
+
+/**
+*   @brief Reads "number" long-arguments of "push_many", "pop_many" or "blit" by the lexer in batches. Adds them in "cpu->machine.code".
+*   @brief If the part of the source ends before the last argument, the number of the rest ones is put in "program->part_need".
+*
+*   @param program [in]  - pointer to the structure with information about source
+*   @param info    [in]  - pointer to the structure with information abour location in source
+*   @param cpu     [out] - pointer to the struct "machine_stream" to add the arguments in "cpu->machine_code"
+*   @param number  [in]  - number of arguments
+*
+*   @return true if arguments are correct and false else
+*/
+
+bool add_many_longs(source *const program, src_location *const info, machine_stream *const cpu, size_t number)
+{
+    assert(program != nullptr);
+    assert(info    != nullptr);
+    assert(cpu     != nullptr);
+
+    const lexer *lex = lex_best();
+    long vals[LONG_BATCH] = {};
+
+    while (number > 0)
+    {
+        size_t batch_num = (number < LONG_BATCH) ? number : LONG_BATCH;
+        size_t read_num  = batch_num;
+
+        info->cur_src_pos = lex->read_longs(program->src_code, info->cur_src_pos, program->part_end, &info->cur_src_line, vals, &read_num);
+        add_machine_cmd(cpu, read_num * sizeof(long), vals);
+
+        if (read_num < batch_num)
+        {
+            if (program->is_part && info->cur_src_pos == program->part_end)
+            {
+                program->part_need = number - read_num;
+                return true;
+            }
+
+            read_val(program, info, ' ', ' ');
+
+            ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid long-argument\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
+            return false;
+        }
+        number -= read_num;
+
+        drop_read_source(program, info);
+    }
+
+    return true;
+}
+
 #define MEM_SYNTAX_CHECK                                                                                                        \
         if  (cmd & CMD_MEM_ARG)                                                                                                 \
         {                                                                                                                       \
             if (info->cur_src_pos < program->src_size && program->src_code[info->cur_src_pos] == ']') ++info->cur_src_pos;      \
             else                                                                                                                \
             {                                                                                                                   \
-                fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "there is no \']\' character\n", info->cur_src_line);         \
+                ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "there is no \']\' character\n", info->cur_src_line);      \
                 return false;                                                                                                   \
             }                                                                                                                   \
         }
@@ -392,13 +1103,13 @@ bool pop_many(source *const program, src_location *const info, machine *const cp
 *
 *   @param program [in]  - pointer to the structure with information about source
 *   @param info    [in]  - pointer to the structure with information abour location in source
-*   @param cpu     [out] - pointer to the struct "machine" to add the command and arguments in "cpu->machine_code"
+*   @param cpu     [out] - pointer to the struct "machine_stream" to add the command and arguments in "cpu->machine_code"
 *   @param cmd     [in]  - value equal to CMD_POP to read pop-arguments and CMD_PUSH to read push-arguments
 *
 *   @return true if arguments are correct and false else
 */
 
-bool read_push_pop_arg(source *const program, src_location *const info, machine *const cpu, unsigned char cmd)
+bool read_push_pop_arg(source *const program, src_location *const info, machine_stream *const cpu, unsigned char cmd)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
@@ -418,7 +1129,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
         //------------
         long long_arg = 0;
         char long_reg = 0;
-        if (is_long(info->cur_src_cmd, &long_arg))
+        if (is_long(info->cur_src_cmd, info->cur_src_len, &long_arg))
         {
             //------------------
             //fprintf(stderr, "arg = \"%s\" is long\n", info->cur_src_cmd);
@@ -431,7 +1142,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 ++info->cur_src_pos;
                 read_val(program, info, ']');
 
-                if (is_long_reg(info->cur_src_cmd, &long_reg))
+                if (is_long_reg(info->cur_src_cmd, info->cur_src_len, &long_reg))
                 {
                     MEM_SYNTAX_CHECK
                     cmd = cmd | CMD_REG_ARG;
@@ -444,7 +1155,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 }
                 else
                 {
-                    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a long-type register name\n", info->cur_src_line, info->cur_src_cmd);
+                    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a long-type register name\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
                     return false;
                 }
             } //if only long arg
@@ -458,7 +1169,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 return true;
             }
         } //if first argument is not long
-        else if (is_long_reg(info->cur_src_cmd, &long_reg))
+        else if (is_long_reg(info->cur_src_cmd, info->cur_src_len, &long_reg))
         {
             cmd = cmd | CMD_REG_ARG;
             skip_spaces(program, info);
@@ -468,7 +1179,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 ++info->cur_src_pos;
                 read_val(program, info, ']');
 
-                if (is_long(info->cur_src_cmd, &long_arg))
+                if (is_long(info->cur_src_cmd, info->cur_src_len, &long_arg))
                 {
                     MEM_SYNTAX_CHECK
                     cmd = cmd | CMD_NUM_ARG;
@@ -481,7 +1192,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 }
                 else
                 {
-                    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid long\n", info->cur_src_line, info->cur_src_cmd);
+                    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid long\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
                     return false;
                 }
             } //if only register arg
@@ -495,7 +1206,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
                 return true;
             }
         } //if invalid arguments
-        fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid RAM-argument\n", info->cur_src_line, info->cur_src_cmd);
+        ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid RAM-argument\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
         return false;
     } //if not MEM arguments
 
@@ -503,7 +1214,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
 
     long lng_arg = 0;
     char reg_arg = 0;
-    if (is_long(info->cur_src_cmd, &lng_arg))
+    if (is_long(info->cur_src_cmd, info->cur_src_len, &lng_arg))
     {
         cmd = cmd | CMD_NUM_ARG;
         skip_spaces(program, info);
@@ -513,7 +1224,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             ++info->cur_src_pos;
             read_val(program, info, ']');
 
-            if (is_reg(info->cur_src_cmd, &reg_arg) || is_long_reg(info->cur_src_cmd, &reg_arg))
+            if (is_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg) || is_long_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg))
             {
                 cmd = cmd | CMD_REG_ARG;
 
@@ -525,7 +1236,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             }
             else
             {
-                fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a register name\n", info->cur_src_line, info->cur_src_cmd);
+                ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a register name\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
                 return false;
             }
         } //if only long arg
@@ -537,7 +1248,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             return true;
         }
     } //if first argument is not "long"
-    else if (is_reg(info->cur_src_cmd, &reg_arg) || is_long_reg(info->cur_src_cmd, &reg_arg))
+    else if (is_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg) || is_long_reg(info->cur_src_cmd, info->cur_src_len, &reg_arg))
     {
         cmd = cmd | CMD_REG_ARG;
         skip_spaces(program, info);
@@ -547,7 +1258,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             ++info->cur_src_pos;
             read_val(program, info, ']');
 
-            if (is_long(info->cur_src_cmd, &lng_arg))
+            if (is_long(info->cur_src_cmd, info->cur_src_len, &lng_arg))
             {
                 cmd = cmd | CMD_NUM_ARG;
 
@@ -559,7 +1270,7 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             }
             else
             {
-                fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid double\n", info->cur_src_line, info->cur_src_cmd);
+                ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid double\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
                 return false;
             }
         } //if only register arg
@@ -571,54 +1282,127 @@ bool read_push_pop_arg(source *const program, src_location *const info, machine
             return true;
         }
     } //if invalid arguments
-    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a valid argument\n", info->cur_src_line, info->cur_src_cmd);
+    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a valid argument\n", info->cur_src_line, info->cur_src_len, info->cur_src_cmd);
     return false;
 }   
 
 /**
-*   @brief Reads jmp-arguments. Works in two modes.
-*   @brief If "mark_mode" is MARK_GET,   in case of non-existent mark it skips this mark and continue the assembler. (This mark can appear in the code below).
-*   @brief If "mark_mode" is MARK_CHECK, in case of non-existent mark it give an error-message.  
+*   @brief Reads jmp-arguments. Adds the command and the position of the mark in "cpu->machine_code".
+*   @brief If the mark is not met yet, adds the invalid position and puts the fixup in "fixups" to patch it later.
 *
-*   @param program   [in]      - pointer to the structure with information about source
-*   @param info      [in]      - pointer to the structure with information abour location in source
-*   @param cpu       [out]     - pointer to the struct "machine" to add the command and arguments in "cpu->machine_code"
-*   @param label     [in][out] - pointer to the store of marks
-*   @param mark_mode [in]      - mode of the function
+*   @param program [in]      - pointer to the structure with information about source
+*   @param info    [in]      - pointer to the structure with information abour location in source
+*   @param cpu     [out]     - pointer to the struct "machine_stream" to add the command and arguments in "cpu->machine_code"
+*   @param label   [in]      - pointer to the store of marks
+*   @param fixups  [in][out] - pointer to the list of jumps to marks which are not met yet
 *
-*   @return in MARK_CHECK-mode in case of non-existent mark returns false and true else
+*   @return true
 */
 
-bool cmd_jmp(source *const program, src_location *const info, machine *const cpu, tag *const label, const char mark_mode, unsigned char cmd)
+bool cmd_jmp(source *const program, src_location *const info, machine_stream *const cpu, tag *const label, fixup_list *const fixups, unsigned char cmd)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
     assert(cpu     != nullptr);
     assert(label   != nullptr);
+    assert(fixups  != nullptr);
 
-    assert(mark_mode == 0 || mark_mode == 1);
+    size_t mark_begin = read_val(program, info, ' ');
 
-    read_val(program, info, ' ');
+    add_machine_cmd(cpu, sizeof(char), &cmd);
 
     int  label_pos = 0;
-    if ((label_pos = tag_string_find(label, info->cur_src_cmd)) != -1)
+    if (!program->is_part && (label_pos = tag_mark_find(label, {(char *) info->cur_src_cmd, info->cur_src_len, 0})) != -1)
     {
-        add_machine_cmd(cpu, sizeof(char), &cmd);
-        add_machine_cmd(cpu, sizeof(int) , &label->data[label_pos].machine_pos);
-
+        add_machine_cmd(cpu, sizeof(int), &label->data[label_pos].machine_pos);
         return true;
     }
 
-    if (mark_mode == MARK_GET)
+    fixup_push(fixups, {program->src_code + mark_begin, info->cur_src_len, cpu->machine_pos, info->cur_src_line});
+
+    int invalid_pos = -1;
+    add_machine_cmd(cpu, sizeof(int), &invalid_pos);
+
+    return true;
+}
+
+/**
+*   @brief Patches jumps to marks which were not met when the jumps were read.
+*   @brief Gives an error-message for every jump to non-existent mark.
+*
+*   @param cpu    [out] - pointer to the struct "machine_stream" with "machine_code" to patch
+*   @param label  [in]  - pointer to the store of all marks
+*   @param fixups [in]  - pointer to the list of jumps to patch
+*
+*   @return false if there are jumps to non-existent marks and true else
+*/
+
+bool resolve_fixups(machine_stream *const cpu, tag *const label, const fixup_list *const fixups)
+{
+    assert(cpu    != nullptr);
+    assert(label  != nullptr);
+    assert(fixups != nullptr);
+
+    bool is_resolved = true;
+
+    // fixups are sorted by position, so the ones in the written part of the machine code are patched by blocks read back from the file
+    char  *block      = nullptr;
+    int    block_pos  = 0;
+    size_t block_size = 0;
+
+    for (size_t fixup_cnt = 0; fixup_cnt < fixups->size; ++fixup_cnt)
+    {
+        const fixup *cur = fixups->data + fixup_cnt;
+
+        int label_pos = tag_mark_find(label, {(char *) cur->mark_ptr, cur->mark_size, 0});
+        if (label_pos == -1)
+        {
+            fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%.*s\" is not a mark\n", cur->src_line, cur->mark_size, cur->mark_ptr);
+            is_resolved = false;
+            continue;
+        }
+
+        if (cur->machine_pos + (int) sizeof(int) > cpu->flushed_pos)
+        {
+            patch_machine_cmd(cpu, cur->machine_pos, sizeof(int), &label->data[label_pos].machine_pos);
+            continue;
+        }
+
+        if (cur->machine_pos + sizeof(int) > block_pos + block_size)
+        {
+            if (block_size != 0) machine_write(cpu, block, block_size, block_pos);
+
+            block_pos  = cur->machine_pos;
+            block_size = (size_t) (cpu->flushed_pos - block_pos);
+            if (block_size > MACHINE_BUF_SIZE) block_size = MACHINE_BUF_SIZE;
+
+            if (block == nullptr) block = (char *) calloc(MACHINE_BUF_SIZE, sizeof(char));
+            assert(block != nullptr);
+
+            machine_read(cpu, block, block_size, block_pos);
+        }
+
+        memcpy(block + (cur->machine_pos - block_pos), &label->data[label_pos].machine_pos, sizeof(int));
+    }
+
+    if (block_size != 0) machine_write(cpu, block, block_size, block_pos);
+    free(block);
+
+    return is_resolved;
+}
+
+void fixup_push(fixup_list *const fixups, const fixup push_val)
+{
+    assert(fixups != nullptr);
+
+    if (fixups->size == fixups->capacity)
     {
-        char temp_invalid_ptr = -1;
-        add_machine_cmd(cpu, sizeof(char), &cmd);
-        add_machine_cmd(cpu, sizeof(int) , &temp_invalid_ptr);
-        return true;
+        fixups->capacity = (fixups->capacity == 0) ? 64 : 2 * fixups->capacity;
+        fixups->data     = (fixup *) realloc(fixups->data, sizeof(fixup) * fixups->capacity);
+        assert(fixups->data != nullptr);
     }
 
-    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "\"%s\" is not a mark\n", info->cur_src_line, info->cur_src_cmd);
-    return false;
+    fixups->data[fixups->size++] = push_val;
 }
 
 bool is_comment(source *const program, src_location *const info)
@@ -626,7 +1410,7 @@ bool is_comment(source *const program, src_location *const info)
     assert(program != nullptr);
     assert(info    != nullptr);
 
-    if (info->cur_src_cmd[0] == '#')
+    if (info->cur_src_len > 0 && info->cur_src_cmd[0] == '#')
     {
         while (info->cur_src_pos <  program->src_size && program->src_code[info->cur_src_pos] != '\n') ++info->cur_src_pos;
         if    (info->cur_src_pos != program->src_size) ++info->cur_src_pos;
@@ -638,76 +1422,258 @@ bool is_comment(source *const program, src_location *const info)
 }
 
 /**
-*   @brief Function working with marks. Works in two modes.
-*   @brief In MARK_GET-mode it determines if another string is a mark declaration or not. In the first case it puts the mark in "label".
-*   @brief In MARK_CHECK-mode it immediately returns.
+*   @brief Determines if another string is a mark declaration or not. In the first case it puts the mark in "label".
 *
 *   @param program          [in]      - pointer to the structure with information about source
 *   @param info             [in]      - pointer to the structure with information abour location in source
-*   @param cpu              [out]     - pointer to the struct "machine" to add the command and arguments in "cpu->machine_code"
+*   @param cpu              [out]     - pointer to the struct "machine_stream" to add the command and arguments in "cpu->machine_code"
 *   @param label            [in][out] - pointer to the store of marks
 *   @param possible_mrk_beg [in]      - index   of the beginning of possible mark 
-*   @param mark_mode        [in]      - mode of the function
 *
-*   @return in MARK_GET-mode in case of invalid mark(already declareted mark or string with no ':' character in the end) returns false and true else
+*   @return in case of invalid mark(already declareted mark or string with no ':' character in the end) returns false and true else
 */
 
-bool get_mark(source *const program, src_location *const info, machine *const cpu, tag *const label, const int possible_mrk_beg, const char mark_mode)
+bool get_mark(source *const program, src_location *const info, machine_stream *const cpu, tag *const label, const size_t possible_mrk_beg)
 {
     assert(program != nullptr);
     assert(info    != nullptr);
     assert(cpu     != nullptr);
     assert(label   != nullptr);
 
-    assert(mark_mode == 0 || mark_mode == 1);
-
-    if (mark_mode == MARK_CHECK)
-    {
-        ++info->cur_src_pos;
-        return true;
-    }
-
     int cur_line = info->cur_src_line;
     skip_spaces(program, info);
     
     if (info->cur_src_pos < program->src_size)
     {
-        int mrk_size = strlen(info->cur_src_cmd);
-        if (program->src_code[info->cur_src_pos] == ':' && tag_push(label, {program->src_code + possible_mrk_beg, mrk_size, cpu->machine_pos}))
+        int mrk_size = info->cur_src_len;
+        if (program->src_code[info->cur_src_pos] == ':' && tag_push(label, {(char *) program->src_code + possible_mrk_beg, mrk_size, cpu->machine_pos}))
         {
             ++info->cur_src_pos;
             return true;
         }
         if (program->src_code[info->cur_src_pos] == ':')
         {
-            fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "the mark \"%s\" has already met\n", cur_line, info->cur_src_cmd);
+            ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "the mark \"%.*s\" has already met\n", cur_line, info->cur_src_len, info->cur_src_cmd);
             
             ++info->cur_src_pos;
             return false;
         }
     }
 
-    fprintf(stderr, "line %4d: " RED "ERROR: " CANCEL "command \"%s\" is not existing\n", cur_line, info->cur_src_cmd);
+    ASM_ERROR(program, "line %4d: " RED "ERROR: " CANCEL "command \"%.*s\" is not existing\n", cur_line, info->cur_src_len, info->cur_src_cmd);
     return false;
 }
 
+/**
+*   @brief Opens the file "output_file" to write the machine code in.
+*
+*   @param cpu         [out] - pointer to the struct "machine_stream" to open
+*   @param output_file [in]  - name of the file, nullptr to keep the whole machine code in memory
+*
+*   @return true if the file is opened and false else
+*/
+
+bool machine_ctor(machine_stream *const cpu, const char *output_file)
+{
+    assert(cpu != nullptr);
+
+    *cpu = {};
+
+    cpu->capacity     = MACHINE_BUF_SIZE;
+    cpu->machine_code = (char *) calloc(cpu->capacity, sizeof(char));
+    assert(cpu->machine_code != nullptr);
+
+    cpu->out_fd = -1;
+    if (output_file == nullptr) return true;
+
+    // written blocks are patched by "pread()" and "pwrite()", so they are streamed only to a readable regular file
+    if ((cpu->out_fd = open(output_file, O_RDWR | O_CREAT | O_TRUNC, 0644)) != -1)
+    {
+        struct stat out_stat = {};
+        cpu->is_stream = (fstat(cpu->out_fd, &out_stat) == 0 && S_ISREG(out_stat.st_mode));
+    }
+    else if ((cpu->out_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+    {
+        free(cpu->machine_code);
+        return false;
+    }
+
+    return true;
+}
+
+void machine_dtor(machine_stream *const cpu)
+{
+    assert(cpu != nullptr);
+
+    free(cpu->machine_code);
+    if (cpu->out_fd != -1) close(cpu->out_fd);
+
+    *cpu = {};
+    cpu->out_fd = -1;
+}
+
 /**
 *   @brief Adds command or argument in "cpu->machine_code".
+*   @brief If the buffer is full, it is written to the file or, if the output is not a regular file, it grows.
+*
+*   @param cpu      - [out] pointer to the struct "machine_stream" to add the command in "cpu->machine_code"
+*   @param val_size - [in]  size (in bytes) of value to put
+*   @param val_ptr  - [in]  pointer to the value to put
+*
+*   @return nothing
+*/
+
+void add_machine_cmd (machine_stream *const cpu, const size_t val_size, void *val_ptr)
+{
+    assert(cpu     != nullptr);
+    assert(val_ptr != nullptr);
+
+    if ((size_t) (cpu->machine_pos - cpu->flushed_pos) + val_size > cpu->capacity) machine_reserve(cpu, val_size);
+
+    memcpy(cpu->machine_code + (cpu->machine_pos - cpu->flushed_pos), val_ptr, val_size);
+    cpu->machine_pos += (int) val_size;
+}
+
+/**
+*   @brief Adds "size" bytes of the machine code. A block larger than the buffer is written to the file directly.
+*/
+
+void add_machine_block(machine_stream *const cpu, const size_t size, void *data)
+{
+    assert(cpu  != nullptr);
+    assert(data != nullptr);
+
+    if (!cpu->is_stream || size < cpu->capacity)
+    {
+        add_machine_cmd(cpu, size, data);
+        return;
+    }
+
+    machine_write(cpu, cpu->machine_code, (size_t) (cpu->machine_pos - cpu->flushed_pos), cpu->flushed_pos);
+    machine_write(cpu, data, size, cpu->machine_pos);
+
+    cpu->machine_pos += (int) size;
+    cpu->flushed_pos  = cpu->machine_pos;
+}
+
+/**
+*   @brief Frees space for "val_size" bytes in "cpu->machine_code": writes the buffer to the file or,
+*   @brief if the output is not a regular file, makes the buffer grow.
+*/
+
+void machine_reserve(machine_stream *const cpu, const size_t val_size)
+{
+    assert(cpu != nullptr);
+
+    size_t used = (size_t) (cpu->machine_pos - cpu->flushed_pos);
+
+    if (cpu->is_stream)
+    {
+        machine_write(cpu, cpu->machine_code, used, cpu->flushed_pos);
+
+        cpu->flushed_pos = cpu->machine_pos;
+        used             = 0;
+    }
+    if (used + val_size > cpu->capacity)
+    {
+        while (used + val_size > cpu->capacity) cpu->capacity *= 2;
+
+        cpu->machine_code = (char *) realloc(cpu->machine_code, cpu->capacity);
+        assert(cpu->machine_code != nullptr);
+    }
+}
+
+/**
+*   @brief Overwrites "val_size" bytes of the machine code from the position "pos". Bytes already written to the file are patched in it.
 *
-*   @param cpu      - [out] pointer to the struct "machine" to add the command in "cpu->machine_code"
+*   @param cpu      - [out] pointer to the struct "machine_stream" to patch
+*   @param pos      - [in]  position of the first byte to overwrite
 *   @param val_size - [in]  size (in bytes) of value to put
 *   @param val_ptr  - [in]  pointer to the value to put
 *
 *   @return nothing
 */
 
-void add_machine_cmd (machine *const cpu, const size_t val_size, void *val_ptr)
+void patch_machine_cmd(machine_stream *const cpu, const int pos, const size_t val_size, const void *val_ptr)
 {
     assert(cpu     != nullptr);
     assert(val_ptr != nullptr);
+    assert(pos >= 0 && pos + (int) val_size <= cpu->machine_pos);
+
+    size_t flushed_num = 0;
+
+    if (pos < cpu->flushed_pos)
+    {
+        flushed_num = (size_t) (cpu->flushed_pos - pos);
+        if (flushed_num > val_size) flushed_num = val_size;
+
+        machine_write(cpu, val_ptr, flushed_num, pos);
+    }
+
+    memcpy(cpu->machine_code + (pos + (int) flushed_num - cpu->flushed_pos), (const char *) val_ptr + flushed_num, val_size - flushed_num);
+}
+
+/**
+*   @brief Writes the rest of the machine code to the file.
+*
+*   @return true if all the machine code is written and false else
+*/
+
+bool machine_flush(machine_stream *const cpu)
+{
+    assert(cpu != nullptr);
+
+    machine_write(cpu, cpu->machine_code, (size_t) (cpu->machine_pos - cpu->flushed_pos), cpu->flushed_pos);
+    cpu->flushed_pos = cpu->machine_pos;
+
+    return !cpu->is_error;
+}
+
+/**
+*   @brief Writes "size" bytes of "data" to the position "pos" of the file. Sets "cpu->is_error" in case of error.
+*/
+
+void machine_write(machine_stream *const cpu, const void *data, const size_t size, const int pos)
+{
+    assert(cpu  != nullptr);
+    assert(data != nullptr);
+
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t ret = cpu->is_stream ? pwrite(cpu->out_fd, (const char *) data + written, size - written, pos + (off_t) written) :
+                                       write (cpu->out_fd, (const char *) data + written, size - written);
+        if (ret <= 0)
+        {
+            cpu->is_error = true;
+            return;
+        }
+        written += (size_t) ret;
+    }
+}
+
+/**
+*   @brief Reads "size" bytes of the machine code already written to the file from the position "pos". Sets "cpu->is_error" in case of error.
+*/
+
+void machine_read(machine_stream *const cpu, void *data, const size_t size, const int pos)
+{
+    assert(cpu  != nullptr);
+    assert(data != nullptr);
 
-    memcpy((char *) cpu->machine_code + cpu->machine_pos, val_ptr, val_size);
-    cpu->machine_pos += val_size;
+    size_t done = 0;
+
+    while (done < size)
+    {
+        ssize_t ret = pread(cpu->out_fd, (char *) data + done, size - done, pos + (off_t) done);
+        if (ret <= 0)
+        {
+            cpu->is_error = true;
+            return;
+        }
+        done += (size_t) ret;
+    }
 }
 
 /**
@@ -732,9 +1698,11 @@ bool is_double(const char *s, double *const val)
 }
 
 /**
-*   @brief Checks if "*s" is valid long. Puts the value in "val".
+*   @brief Checks if "s" of "len" characters is valid long as "strtol()" in base 10 does: optional sign and decimal digits.
+*   @brief Puts the value in "val", it is saturated to LONG_MIN or LONG_MAX in case of overflow.
 *
-*   @param s   [in]  - pointer to the first byte of null-terminated byte string to check
+*   @param s   [in]  - pointer to the first character to check
+*   @param len [in]  - number of characters to check
 *   @param val [out] - pointer to the "long" variable to put the result
 *
 *   @return true if argument is valid and false else
@@ -742,20 +1710,16 @@ bool is_double(const char *s, double *const val)
 *   @note you should ignore "*val" if "is_long()" returns false
 */
 
-bool is_long(const char *s, long *const val)
+bool is_long(const char *s, const int len, long *const val)
 {
-    assert (s != nullptr);
-
-    char *check = nullptr;
-    *val = strtol(s, &check, 10);
-
-    return !(*check) && check != s;
+    return lex_long(s, len, val);
 }
 
 /**
-*   @brief Checks if "*s" is the "double type" rigister name. Puts number of register in "pos".
+*   @brief Checks if "s" of "len" characters is the "double type" rigister name. Puts number of register in "pos".
 *
-*   @param s   [in]  - pointer to the first byte of null-terminated byte string to check
+*   @param s   [in]  - pointer to the first character to check
+*   @param len [in]  - number of characters to check
 *   @param pos [out] - pointer to the number of register
 *
 *   @return true if "s" - name of register and false else
@@ -763,14 +1727,14 @@ bool is_long(const char *s, long *const val)
 *   @note you should ignore "*pos" id "is_reg()" returns false
 */
 
-bool is_reg(const char *s, char *const pos)
+bool is_reg(const char *s, const int len, char *const pos)
 {
     assert(s   != nullptr);
     assert(pos != nullptr);
 
     for (char reg_cnt = REG_NUM / 2 + 1; reg_cnt <= REG_NUM; ++reg_cnt)
     {
-        if (!strcmp(s, reg_names[reg_cnt]))
+        if (len == (int) strlen(reg_names[(int) reg_cnt]) && !strncmp(s, reg_names[(int) reg_cnt], len))
         {
             *pos = reg_cnt;
             return true;
@@ -780,9 +1744,10 @@ bool is_reg(const char *s, char *const pos)
 }
 
 /**
-*   @brief Checks if "*s" is the name of "long" type rigister. Puts number of register in "pos".
+*   @brief Checks if "s" of "len" characters is the name of "long" type rigister. Puts number of register in "pos".
 *
-*   @param s   [in]  - pointer to the first byte of null-terminated byte string to check
+*   @param s   [in]  - pointer to the first character to check
+*   @param len [in]  - number of characters to check
 *   @param pos [out] - pointer to the number of register
 *
 *   @return true if "s" - name of "int" type register and false else
@@ -790,14 +1755,14 @@ bool is_reg(const char *s, char *const pos)
 *   @note you should ignore "*pos" if "is_long_reg()" returns false
 */
 
-bool is_long_reg(const char *s, char *const pos)
+bool is_long_reg(const char *s, const int len, char *const pos)
 {
     assert(s   != nullptr);
     assert(pos != nullptr);
 
     for (char reg_cnt = 1; reg_cnt <= REG_NUM / 2; ++reg_cnt)
     {
-        if (!strcmp(s, reg_names[reg_cnt]))
+        if (len == (int) strlen(reg_names[(int) reg_cnt]) && !strncmp(s, reg_names[(int) reg_cnt], len))
         {
             *pos = reg_cnt;
             return true;
@@ -833,6 +1798,27 @@ void skip_spaces(source *const program, src_location *const info)
     }
 }
 
+/**
+*   @brief Drops the pages of the read part of the source from memory if it has grown by "SRC_DROP_SIZE" bytes,
+*   @brief so memory used by the source doesn't depend on its size. Marks are still read from the source, their pages are read again.
+*
+*   @param program [in] - pointer to the structure with information about source
+*   @param info    [in] - pointer to the structure with information about location in source
+*
+*   @return nothing
+*/
+
+void drop_read_source(source *const program, const src_location *const info)
+{
+    assert(program != nullptr);
+    assert(info    != nullptr);
+
+    if (program->is_part || info->cur_src_pos < program->dropped_size + SRC_DROP_SIZE) return;
+
+    program->dropped_size = info->cur_src_pos;
+    drop_file_pages(program->src_code, program->dropped_size);
+}
+
 void write_wrong_signature(const char *output_file)
 {
     void *machine_data = make_wrong_signature();
@@ -6,7 +6,13 @@ DEF_CMD(HLT, 0,
 
 DEF_CMD(PUSH, 1,
 {
-    cmd_push(progress);
+    ERRORS status = cmd_push(progress, cur);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
 })
 
 DEF_CMD(ADD, 2,
@@ -39,7 +45,7 @@ DEF_CMD(IN, 19,
 {
     stack_el a = 0;
 
-    scanf("%llu", &a);
+    vm_io_read(progress->io, &a);
     PUSH(a);
 })
 
@@ -57,7 +63,7 @@ DEF_CMD(NOT_EXICTING, 7,
 
 DEF_CMD(POP, 8,
 {
-    ERRORS status = cmd_pop(progress);
+    ERRORS status = cmd_pop(progress, cur);
 
     if (status != OK)
     {
@@ -69,7 +75,7 @@ DEF_CMD(POP, 8,
 DEF_CMD(CALL, 9,
 {
     ADD_POINT()
-    cmd_jmp(progress);
+    cmd_jmp(progress, cur);
 })
 
 DEF_CMD(RET, 10,
@@ -80,7 +86,7 @@ DEF_CMD(RET, 10,
 
 DEF_CMD(JMP, 11,
 {
-    cmd_jmp(progress);
+    cmd_jmp(progress, cur);
 })
 
 DEF_CMD(SQRT, 12,
@@ -99,12 +105,62 @@ DEF_CMD(DRAW, 20,
 
 DEF_CMD(PUSH_MANY, 21, 
 {
-    cmd_push_many(progress);
+    cmd_push_many(progress, cur);
 })
 
 DEF_CMD(POP_MANY, 22,
 {
-    cmd_pop_many(progress);
+    ERRORS status = cmd_pop_many(progress, cur);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
+})
+
+DEF_CMD(BLIT, 23,
+{
+    ERRORS status = cmd_blit(progress, cur);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
+})
+
+DEF_CMD(MEMSET, 24,
+{
+    ERRORS status = cmd_memset(progress);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
+})
+
+DEF_CMD(MEMCPY, 25,
+{
+    ERRORS status = cmd_memcpy(progress);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
+})
+
+DEF_CMD(FILL_RECT, 26,
+{
+    ERRORS status = cmd_fill_rect(progress);
+
+    if (status != OK)
+    {
+        output_error(status);
+        return false;
+    }
 })
 
 DEF_JMP_CMD(JA , 13, >)
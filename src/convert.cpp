@@ -0,0 +1,128 @@
+/** @file */
+
+#include <stdio.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CONVERT_X86
+#include <immintrin.h>
+#endif
+
+#include "convert.h"
+
+static void convert_scalar (unsigned *dst, const stack_el *src, const size_t num);
+
+#ifdef CONVERT_X86
+static void convert_sse2   (unsigned *dst, const stack_el *src, const size_t num);
+static void convert_avx2   (unsigned *dst, const stack_el *src, const size_t num);
+#endif
+
+static convert_func convert_best = nullptr;
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Gets the kernel converting RAM cells to RGBA-pixels (every cell is truncated to its low 32 bits).
+*
+*   @param kernel [in] - kernel to get
+*
+*   @return the kernel or nullptr if the processor doesn't support it
+*/
+
+convert_func convert_get(const CONVERT_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case CONVERT_SCALAR: return convert_scalar;
+
+#ifdef CONVERT_X86
+        case CONVERT_SSE2:   return convert_sse2;
+        case CONVERT_AVX2:   return __builtin_cpu_supports("avx2") ? convert_avx2 : nullptr;
+#endif
+
+        default:             return nullptr;
+    }
+}
+
+const char *convert_name(const CONVERT_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case CONVERT_SCALAR: return "scalar";
+        case CONVERT_SSE2:   return "sse2";
+        case CONVERT_AVX2:   return "avx2";
+        default:             return "unknown";
+    }
+}
+
+/**
+*   @brief Converts "num" RAM cells to RGBA-pixels by the best kernel supported by the processor.
+*   @brief The kernel is chosen at the first call.
+*
+*   @param dst [out] - pixels
+*   @param src [in]  - RAM cells
+*   @param num [in]  - number of cells
+*/
+
+void convert_cells(unsigned *dst, const stack_el *src, const size_t num)
+{
+    assert(dst != nullptr);
+    assert(src != nullptr);
+
+    if (convert_best == nullptr)
+    {
+        for (int kernel = CONVERT_KERNEL_NUM - 1; convert_best == nullptr; --kernel) convert_best = convert_get((CONVERT_KERNEL) kernel);
+    }
+
+    convert_best(dst, src, num);
+}
+
+static void convert_scalar(unsigned *dst, const stack_el *src, const size_t num)
+{
+    for (size_t cnt = 0; cnt < num; ++cnt) dst[cnt] = (unsigned) src[cnt];
+}
+
+#ifdef CONVERT_X86
+
+/**
+*   @brief Converts 4 cells per step: takes the low halves of two pairs of cells by one shuffle.
+*/
+
+static void convert_sse2(unsigned *dst, const stack_el *src, const size_t num)
+{
+    size_t cnt = 0;
+
+    for (; cnt + 4 <= num; cnt += 4)
+    {
+        __m128 lo = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (src + cnt)));
+        __m128 hi = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (src + cnt + 2)));
+
+        _mm_storeu_si128((__m128i *) (dst + cnt), _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))));
+    }
+
+    convert_scalar(dst + cnt, src + cnt, num - cnt);
+}
+
+/**
+*   @brief Converts 8 cells per step: gathers the low halves of each 4 cells in the low lane and joins the lanes.
+*/
+
+__attribute__((target("avx2")))
+static void convert_avx2(unsigned *dst, const stack_el *src, const size_t num)
+{
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    size_t cnt = 0;
+
+    for (; cnt + 8 <= num; cnt += 8)
+    {
+        __m256i lo = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (src + cnt)),     low_halves);
+        __m256i hi = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (src + cnt + 4)), low_halves);
+
+        _mm256_storeu_si256((__m256i *) (dst + cnt), _mm256_permute2x128_si256(lo, hi, 0x20));
+    }
+
+    convert_sse2(dst + cnt, src + cnt, num - cnt);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+
+#include "machine.h"
+
+enum CONVERT_KERNEL
+{
+    CONVERT_SCALAR ,
+    CONVERT_SSE2   ,
+    CONVERT_AVX2   ,
+
+    CONVERT_KERNEL_NUM
+};
+
+typedef void (*convert_func) (unsigned *dst, const stack_el *src, const size_t num);
+
+convert_func convert_get   (const CONVERT_KERNEL kernel);
+const char  *convert_name  (const CONVERT_KERNEL kernel);
+void         convert_cells (unsigned *dst, const stack_el *src, const size_t num);
+
+#endif //CONVERT_H
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "convert.h"
+
+const size_t CELL_NUM   = 960 * 720;
+const int    REPEAT_NUM = 500;
+
+double get_time      ();
+double bench_kernel  (convert_func kernel, unsigned *dst, const stack_el *src, const int repeat_num);
+
+/**
+*   @brief Measures speed of the kernels converting a frame of RAM cells to RGBA-pixels.
+*   @brief Speed is counted in read and written bytes: 8 bytes of the cell and 4 bytes of the pixel.
+*
+*   Usage: ./convert_bench [number of frames]
+*/
+
+int main(int argc, char *argv[])
+{
+    int repeat_num = (argc > 1) ? atoi(argv[1]) : REPEAT_NUM;
+    if (repeat_num <= 0) repeat_num = REPEAT_NUM;
+
+    stack_el *src = (stack_el *) calloc(CELL_NUM, sizeof(stack_el));
+    unsigned *dst = (unsigned *) calloc(CELL_NUM, sizeof(unsigned));
+    unsigned *ref = (unsigned *) calloc(CELL_NUM, sizeof(unsigned));
+    assert(src != nullptr);
+    assert(dst != nullptr);
+    assert(ref != nullptr);
+
+    srand(0);
+    for (size_t cnt = 0; cnt < CELL_NUM; ++cnt) src[cnt] = ((stack_el) rand() << 33) ^ ((stack_el) rand() << 11) ^ (stack_el) rand();
+
+    convert_get(CONVERT_SCALAR)(ref, src, CELL_NUM);
+
+    for (int kernel = 0; kernel < CONVERT_KERNEL_NUM; ++kernel)
+    {
+        convert_func func = convert_get((CONVERT_KERNEL) kernel);
+        if (func == nullptr)
+        {
+            printf("%-8s is not supported\n", convert_name((CONVERT_KERNEL) kernel));
+            continue;
+        }
+
+        memset(dst, 0, CELL_NUM * sizeof(unsigned));
+        func(dst, src, CELL_NUM);
+        if (memcmp(dst, ref, CELL_NUM * sizeof(unsigned)) != 0)
+        {
+            printf("%-8s gives wrong pixels\n", convert_name((CONVERT_KERNEL) kernel));
+            continue;
+        }
+
+        double sec   = bench_kernel(func, dst, src, repeat_num);
+        double bytes = (double) repeat_num * CELL_NUM * (sizeof(stack_el) + sizeof(unsigned));
+
+        printf("%-8s %8.3f ms/frame %8.2f GB/s\n", convert_name((CONVERT_KERNEL) kernel), 1000 * sec / repeat_num, bytes / sec / 1e9);
+    }
+
+    free(src);
+    free(dst);
+    free(ref);
+}
+
+double bench_kernel(convert_func kernel, unsigned *dst, const stack_el *src, const int repeat_num)
+{
+    assert(kernel != nullptr);
+
+    kernel(dst, src, CELL_NUM);
+
+    double start = get_time();
+    for (int repeat_cnt = 0; repeat_cnt < repeat_num; ++repeat_cnt) kernel(dst, src, CELL_NUM);
+
+    return get_time() - start;
+}
+
+double get_time()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
@@ -3,47 +3,43 @@
 #include <assert.h>
 #include <math.h>
 #include <string.h>
-#include <SFML/Graphics.hpp>
 
 #define RED    "\e[1;31m"
 #define CANCEL "\e[0m"
 #define GREEN  "\e[0;32m"
 
 #include "read_write.h"
-#include "stack.h"
-#include "machine.h"
-
-const int REG_NUM =       8;
-const int WIDTH   =     960;
-const int HEIGHT  =     720;
-const int RAM_NUM = 960*720;
-const int RAM_STR =     100;
+#include "cpu.h"
+#include "jit.h"
+#include "display.h"
+#include "verify.h"
+#include "optimize.h"
+#include "gdz.h"
+
+enum ENGINE
+{
+    ENGINE_SWITCH  , // 0
+    ENGINE_THREADED, // 1
+    ENGINE_JIT     , // 2
+    ENGINE_STREAM    // 3: containers of "./Asm2 --lz"
+};
 
-struct cpu_store
+struct cpu_options
 {
-    machine execution;
-    size_t  execution_size;
+    const char *exe_file;
 
-    char version;
+    ENGINE engine;
+    bool   jit_check;
 
-    stack calls;
-    stack stk;
-    stack_el  ram [RAM_NUM];
-    stack_el  regs[REG_NUM / 2];
-    long long_regs[REG_NUM / 2 + 1]; //zero register is invalid
-    
+    bool        is_headless;
+    const char *frames_file;
+    bool        no_verify;
+    bool        is_optimized;
+    const char *in_file;
+    const char *out_file;
 };
 
-enum ERRORS
-{
-    OK            ,
-    ZERO_DIVISION ,
-    EMPTY_STACK   ,
-    EMPTY_CALLS   ,
-    UNDEFINED_CMD ,
-    MEMORY_LIMIT  ,
-    NEG_VALUE
-};
+const int INLINE_BUDGET = 1024; // instructions which "--optimize" can add by inlining
 
 const char *error_messages[] = 
 {
@@ -59,26 +55,41 @@ const char *error_messages[] =
 
 /*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
 
+bool     parse_options    (int argc, char *argv[], cpu_options *const options);
 bool     check_signature  (cpu_store *progress);
-bool     execution        (cpu_store *progress);
+void     optimize_loaded  (cpu_store *progress);
+bool     execution        (cpu_store *progress, const cpu_options *options);
+template <bool CHECKED>
+bool     execution_switch (cpu_store *progress, display &wnd, bool &is_hlt);
+template <bool CHECKED>
+bool     execution_thread (cpu_store *progress, display &wnd, bool &is_hlt);
+bool     execution_jit    (cpu_store *progress, jit_code *jit, display &wnd, bool &is_hlt);
+bool     execution_stream (cpu_store *progress, display &wnd, bool &is_hlt);
+bool     execution_step   (cpu_store *progress, display &wnd, bool &is_hlt);
+bool     jit_check        (cpu_store *progress, jit_code *jit, display &wnd);
 bool     approx_equal     (const double a,   const double b);
 bool     approx_cmp       (const stack_el a, const stack_el b, const char *type);
 
-ERRORS   cmd_push         (cpu_store *progress);
-ERRORS   cmd_pop          (cpu_store *progress);
-ERRORS   cmd_jmp          (cpu_store *progress);
-ERRORS   cmd_push_many    (cpu_store *progress);
-ERRORS   cmd_pop_many     (cpu_store *progress);
+ERRORS   cmd_push         (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_pop          (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_jmp          (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_push_many    (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_pop_many     (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_blit         (cpu_store *progress, const instruction *cur);
+ERRORS   cmd_memset       (cpu_store *progress);
+ERRORS   cmd_memcpy       (cpu_store *progress);
+ERRORS   cmd_fill_rect    (cpu_store *progress);
 
-void     cmd_draw         (sf::RenderWindow *wnd, cpu_store *progress);
+void     fill_cells       (cpu_store *progress, const stack_el begin, const stack_el count, const stack_el val);
+void     mark_dirty       (cpu_store *progress, const stack_el begin, const stack_el end);
 
-long     get_memory_val   (cpu_store *const progress, const unsigned char cmd);
+void     cmd_draw         (display *wnd, cpu_store *progress);
+
+long     get_memory_val   (cpu_store *const progress, const instruction *cur);
 
-void    *get_machine_cmd  (cpu_store *const progress, const size_t val_size);
 void     output_error     (ERRORS status);
 
-stack_el get_reg_val      (cpu_store *const progress, const char reg_num);
-stack_el get_stack_el_val (cpu_store *progress, const unsigned char cmd);
+stack_el get_stack_el_val (cpu_store *progress, const instruction *cur);
 
 /*------------------------------------------------------------------------------------------------------*/
 
@@ -86,34 +97,154 @@ int main(int argc, char *argv[])
 {
     fprintf(stderr, "\n");
 
+    cpu_options options = {};
+    if (!parse_options(argc, argv, &options)) return 1;
+
     cpu_store progress = {};
-    stack_ctor(&progress.stk  , sizeof(stack_el));
-    stack_ctor(&progress.calls, sizeof(int));
+    stack_ctor(&progress.stk);
+    stack_ctor(&progress.calls);
+
+    gdz_stream stream = {};
+    if (gdz_is_container(options.exe_file))
+    {
+        if (!gdz_open(&stream, options.exe_file)) return 1;
+
+        progress.stream                 = &stream;
+        progress.execution.machine_code = &stream.machine_info;
+        progress.execution_size         = stream.raw_size;
+    }
+    else progress.execution.machine_code = read_file(options.exe_file, &progress.execution_size);
 
-    progress.execution.machine_code = read_file(argv[1], &progress.execution_size);
     if (progress.execution.machine_code == nullptr)
     {
-        fprintf(stderr, RED "ERROR: " CANCEL "Can't execute the file \"%s\"\n", argv[1]);
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't execute the file \"%s\"\n", options.exe_file);
         return 1;
     }
 
     if (!check_signature(&progress)) return 1;
 
-    bool execution_status = execution(&progress);
+    if (progress.stream != nullptr)
+    {
+        // the whole program is never decoded, so the blocks are only interpreted with checks
+        if (options.engine != ENGINE_SWITCH || options.is_optimized)
+            fprintf(stderr, "./CPU: the container is executed by blocks without translation and optimization\n");
+
+        options.engine    = ENGINE_STREAM;
+        options.jit_check = false;
+    }
+    else
+    {
+        if (!decode_program(progress.execution.machine_code, progress.execution_size, progress.version, &progress.program)) return 1;
+        if (options.is_optimized) optimize_loaded(&progress);
+
+        long max_depth = VERIFY_UNBOUNDED;
+        progress.is_verified = !options.no_verify && verify_program(&progress.program, &max_depth);
+        if (progress.is_verified && max_depth != VERIFY_UNBOUNDED) stack_reserve(&progress.stk, (size_t) max_depth + 1);
+    }
+
+    vm_io io = {};
+    if (!vm_io_ctor(&io, options.in_file, options.out_file)) return 1;
+    progress.io = &io;
+
+    bool execution_status = execution(&progress, &options);
+    vm_io_dtor(&io);
+
+    if (progress.stream != nullptr)
+    {
+        fprintf(stderr, "container: %d blocks, %zu loads, %zu loaded again\n", stream.block_num, stream.load_num, stream.reload_num);
+        gdz_close(&stream);
+    }
+
     if (!execution_status) return 1;
 
     output_error(OK);
 }
 
+/**
+*   @brief Parses command line arguments of "./CPU".
+*
+*   @param argc    [in]  - number of command line arguments
+*   @param argv    [in]  - command line arguments
+*   @param options [out] - pointer to the "cpu_options" to put the result in
+*
+*   @return true if arguments are correct and false else
+*/
+
+bool parse_options(int argc, char *argv[], cpu_options *const options)
+{
+    assert(argv    != nullptr);
+    assert(options != nullptr);
+
+    *options = {nullptr, ENGINE_SWITCH, false, false, nullptr, false, false, nullptr, nullptr};
+
+    for (int arg_cnt = 1; arg_cnt < argc; ++arg_cnt)
+    {
+        if      (!strcmp(argv[arg_cnt], "--switch"  )) options->engine = ENGINE_SWITCH;
+        else if (!strcmp(argv[arg_cnt], "--threaded")) options->engine = ENGINE_THREADED;
+        else if (!strcmp(argv[arg_cnt], "--jit"     )) options->engine = ENGINE_JIT;
+        else if (!strcmp(argv[arg_cnt], "--jit-check"))
+        {
+            options->engine    = ENGINE_JIT;
+            options->jit_check = true;
+        }
+        else if (!strcmp(argv[arg_cnt], "--headless" )) options->is_headless = true;
+        else if (!strcmp(argv[arg_cnt], "--no-verify")) options->no_verify   = true;
+        else if (!strcmp(argv[arg_cnt], "--optimize" )) options->is_optimized = true;
+        else if (!strcmp(argv[arg_cnt], "--frames") && arg_cnt + 1 < argc)
+        {
+            options->is_headless = true;
+            options->frames_file = argv[++arg_cnt];
+        }
+        else if (!strcmp(argv[arg_cnt], "--in" ) && arg_cnt + 1 < argc) options->in_file  = argv[++arg_cnt];
+        else if (!strcmp(argv[arg_cnt], "--out") && arg_cnt + 1 < argc) options->out_file = argv[++arg_cnt];
+        else if (!strcmp(argv[arg_cnt], "--help"))
+        {
+            fprintf(stderr, "usage: ./CPU [--switch | --threaded | --jit | --jit-check] [--headless | --frames FRAMES_FILE] [--no-verify]\n"
+                            "             [--optimize] [--in IN_FILE] [--out OUT_FILE] EXE_FILE\n"
+                            "       --switch    - execute EXE_FILE dispatching commands through one \"switch\" (default)\n"
+                            "       --threaded  - execute EXE_FILE dispatching commands through the table of labels\n"
+                            "       --jit       - translate EXE_FILE to x86-64 code and execute it\n"
+                            "       --jit-check - execute EXE_FILE once by \"--switch\" and once by \"--jit\" and compare RAM and registers\n"
+                            "       --headless  - execute EXE_FILE once without window, frames of \"DRAW\" are dropped\n"
+                            "       --frames    - execute EXE_FILE once without window, frames of \"DRAW\" are appended to FRAMES_FILE\n"
+                            "                     as raw 32-bit RGBA %dx%d pictures\n"
+                            "       --no-verify - don't verify EXE_FILE, the interpreter checks stacks before every command\n"
+                            "       --optimize  - optimize the decoded EXE_FILE before the execution the way \"./Asm2 -O\" does:\n"
+                            "                     inlining, tail calls, constant propagation, dead \"pop reg\", unreachable commands,\n"
+                            "                     constant folding and jumps, the numbers of the commands are printed\n"
+                            "       --in        - read numbers of \"IN\" from IN_FILE instead of stdin\n"
+                            "       --out       - write numbers of \"OUT\" in OUT_FILE instead of stdout\n"
+                            "EXE_FILE of \"./Asm2 --lz\" is executed by blocks while the next ones are decompressed, without translation\n", WIDTH, HEIGHT);
+            return false;
+        }
+        else if (argv[arg_cnt][0] != '-' && options->exe_file == nullptr) options->exe_file = argv[arg_cnt];
+        else
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "Unknown argument \"%s\"\n"
+                            "print \"./CPU --help\"\n", argv[arg_cnt]);
+            return false;
+        }
+    }
+
+    if (options->exe_file == nullptr)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "There is no file to execute\n"
+                        "print \"./CPU --help\"\n");
+        return false;
+    }
+
+    return true;
+}
+
 #define EMPTY_CHECK()                                                               \
-        if (stack_empty(&progress->stk))                                            \
+        if (CHECKED && stack_empty(&progress->stk))                                 \
         {                                                                           \
             output_error(EMPTY_STACK);                                              \
             return false;                                                           \
         }
 
 #define EMPTY_CALLS()                                                               \
-        if (stack_empty(&progress->calls))                                          \
+        if (CHECKED && stack_empty(&progress->calls))                               \
         {                                                                           \
             output_error(EMPTY_CALLS);                                              \
             return false;                                                           \
@@ -127,9 +258,7 @@ int main(int argc, char *argv[])
         }
 
 #define PUSH(val)                                                                   \
-        stack_el push_val = val;                                                    \
-                                                                                    \
-        stack_push(&progress->stk, &push_val);
+        stack_push(&progress->stk, (stack_el) (val));
 
 #define POP()                                                                       \
         EMPTY_CHECK()                                                               \
@@ -137,21 +266,20 @@ int main(int argc, char *argv[])
 
 #define GET_STK_ONE()                                                               \
         EMPTY_CHECK()                                                               \
-        stack_el a = *(stack_el *) stack_front(&progress->stk);
+        stack_el a = stack_front(&progress->stk);
 
 #define GET_STK_TWO()                                                               \
         GET_STK_ONE()                                                               \
         POP()                                                                       \
         EMPTY_CHECK()                                                               \
-        stack_el b = *(stack_el *) stack_front(&progress->stk);                     \
+        stack_el b = stack_front(&progress->stk);                                   \
         POP()
 
 #define PRINT(val)                                                                  \
-        printf("%llu\n", val);
+        vm_io_write(progress->io, val);
 
 #define ADD_POINT()                                                                 \
-        int tmp_ret_val = progress->execution.machine_pos + sizeof(int);            \
-        stack_push(&progress->calls, &tmp_ret_val);
+        stack_push(&progress->calls, progress->pc);
 
 #define DEL_POINT()                                                                 \
         EMPTY_CALLS()                                                               \
@@ -159,7 +287,7 @@ int main(int argc, char *argv[])
 
 #define RETURN()                                                                    \
         EMPTY_CALLS()                                                               \
-        progress->execution.machine_pos = *(int *) stack_front(&progress->calls);
+        progress->pc = stack_front(&progress->calls);
 
 #define NEG_CHECK(val)                                                              \
         if (!approx_equal(val, 0) && val < 0)                                       \
@@ -168,72 +296,373 @@ int main(int argc, char *argv[])
             return false;                                                           \
         }
 
-#define check_event()                                                               \
-        while (wnd.pollEvent(event))                                                \
-        {                                                                           \
-            if (event.type == sf::Event::Closed)                                    \
-            {                                                                       \
-                wnd.close();                                                        \
-                break;                                                              \
-            }                                                                       \
-        }
-
 /**
-*   @brief Manages of program executing by reading commands from "progress->execution.machine_code" and calling functions to execute them.
+*   @brief Manages of program executing. Opens the window and runs the chosen engine until "HLT" or until the window is closed.
+*   @brief In headless mode executes the program once without window.
 *   @brief Prints messages about errors in stderr.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
+*   @param options  [in] - command line options
 *
 *   @return true if there are not any errors and false else
 */
 
-bool execution(cpu_store *progress)
+bool execution(cpu_store *progress, const cpu_options *options)
 {
     assert(progress != nullptr);
+    assert(options  != nullptr);
 
-    sf::RenderWindow wnd(sf::VideoMode(WIDTH, HEIGHT), "RAM");
-    wnd.setFramerateLimit(60);
+    display wnd = {};
+    if (!display_ctor(&wnd, WIDTH, HEIGHT, options->is_headless, options->frames_file)) return false;
 
+    ENGINE   engine = options->engine;
+    jit_code jit    = {};
+
+    if (engine == ENGINE_JIT && !jit_compile(&jit, &progress->program))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "./CPU: can't translate the program, it is executed by the interpreter\n");
+        engine = ENGINE_SWITCH;
+    }
+
+    bool status = true;
     bool is_hlt = false;
 
-    while (wnd.isOpen())
+    memset(progress->dirty, 1, sizeof(progress->dirty)); // the first "DRAW" shows the whole RAM
+
+    if (options->jit_check) status = (engine == ENGINE_JIT) && jit_check(progress, &jit, wnd);
+
+    while (!options->jit_check && status && display_is_open(&wnd))
+    {
+        if (is_hlt)
+        {
+            display_wait(&wnd);
+            continue;
+        }
+
+        progress->pc = 0;
+
+        switch (engine)
+        {
+            case ENGINE_THREADED:
+                if (progress->is_verified) status = execution_thread<false>(progress, wnd, is_hlt);
+                else                       status = execution_thread<true> (progress, wnd, is_hlt);
+                break;
+
+            case ENGINE_JIT:
+                status = execution_jit(progress, &jit, wnd, is_hlt);
+                break;
+
+            case ENGINE_STREAM:
+                status = execution_stream(progress, wnd, is_hlt);
+                break;
+
+            default:
+                if (progress->is_verified) status = execution_switch<false>(progress, wnd, is_hlt);
+                else                       status = execution_switch<true> (progress, wnd, is_hlt);
+                break;
+        }
+        vm_io_flush(progress->io);
+
+        if (wnd.is_headless) break;
+    }
+
+    display_close(&wnd);
+    fprintf(stderr, "frames: %llu produced, %llu presented, %llu dropped, %llu rows updated\n",
+                    wnd.frames_produced, wnd.frames_presented, wnd.frames_dropped, wnd.rows_updated);
+
+    jit_dtor    (&jit);
+    display_dtor(&wnd);
+
+    return status;
+}
+
+/**
+*   @brief Executes the program once from "progress->pc" up to "HLT" or the end of "progress->program".
+*   @brief Dispatches every instruction through one "switch" generated from "cmd.h".
+*   @brief Without CHECKED doesn't check stacks before popping: it is used only for verified programs.
+*
+*   @param progress [in]  - "cpu_store" contains all information about program
+*   @param wnd      [in]  - window to draw RAM in
+*   @param is_hlt   [out] - becomes true after "HLT"
+*
+*   @return true if there are not any errors and false else
+*/
+
+template <bool CHECKED>
+bool execution_switch(cpu_store *progress, display &wnd, bool &is_hlt)
+{
+    assert(progress != nullptr);
+
+    while (is_hlt == false)
+    {
+        const instruction *cur = progress->program.cmds + progress->pc++;
+
+        #define DEF_CMD(name, number, code)                                 \
+                case CMD_##name:                                            \
+                    code                                                    \
+                    break;
+
+        #define DEF_JMP_CMD(name, number, cmp)                              \
+                case CMD_##name:                                            \
+                {                                                           \
+                    GET_STK_TWO()                                           \
+                    if (approx_cmp(b, a, #cmp)) cmd_jmp(progress, cur);     \
+                    break;                                                  \
+                }
+
+        switch (cur->handler)
+        {
+            #include "cmd.h"
+            default:
+                output_error(UNDEFINED_CMD);
+                return false;
+        }
+        #undef DEF_CMD
+        #undef DEF_JMP_CMD
+    }
+
+    return true;
+}
+
+/**
+*   @brief Executes the program once from "progress->pc" up to "HLT" or the end of "progress->program".
+*   @brief Every command generated from "cmd.h" has its own label and ends with its own indirect jump to the next one ("direct threading").
+*
+*   @param progress [in]  - "cpu_store" contains all information about program
+*   @param wnd      [in]  - window to draw RAM in
+*   @param is_hlt   [out] - becomes true after "HLT"
+*
+*   @return true if there are not any errors and false else
+*
+*   @note without computed goto (GNU extension) it falls back to "execution_switch()"
+*   @note without CHECKED stacks aren't checked before popping: it is used only for verified programs
+*/
+
+template <bool CHECKED>
+bool execution_thread(cpu_store *progress, display &wnd, bool &is_hlt)
+{
+    assert(progress != nullptr);
+
+#ifdef __GNUC__
+    void *dispatch_table[mask01 + 1] = {};
+    for (unsigned cmd_cnt = 0; cmd_cnt <= mask01; ++cmd_cnt) dispatch_table[cmd_cnt] = &&cmd_undefined;
+
+    #define DEF_CMD(name, number, code)                                     \
+            dispatch_table[CMD_##name] = &&cmd_##name;
+
+    #define DEF_JMP_CMD(name, number, cmp)                                  \
+            dispatch_table[CMD_##name] = &&cmd_##name;
+
+    #include "cmd.h"
+    #undef DEF_CMD
+    #undef DEF_JMP_CMD
+
+    const instruction *cur = nullptr;
+
+    #define DISPATCH()                                                      \
+            if (is_hlt) return true;                                        \
+                                                                            \
+            cur = progress->program.cmds + progress->pc++;                  \
+            goto *dispatch_table[cur->handler];
+
+    DISPATCH()
+
+    #define DEF_CMD(name, number, code)                                     \
+            cmd_##name:                                                     \
+                do code while (0);                                          \
+                DISPATCH()
+
+    #define DEF_JMP_CMD(name, number, cmp)                                  \
+            cmd_##name:                                                     \
+            {                                                               \
+                GET_STK_TWO()                                               \
+                if (approx_cmp(b, a, #cmp)) cmd_jmp(progress, cur);         \
+            }                                                               \
+                DISPATCH()
+
+    #include "cmd.h"
+    #undef DEF_CMD
+    #undef DEF_JMP_CMD
+    #undef DISPATCH
+
+    cmd_undefined:
+        output_error(UNDEFINED_CMD);
+        return false;
+#else
+    return execution_switch<CHECKED>(progress, wnd, is_hlt);
+#endif
+}
+
+/**
+*   @brief Executes "draw" command: shows RAM on the display.
+*
+*   @param wnd      [in] - display to show RAM on
+*   @param progress [in] - "cpu_store" contains all information about program
+*
+*   @return nothing
+*/
+
+void cmd_draw(display *wnd, cpu_store *progress)
+{
+    assert(wnd      != nullptr);
+    assert(progress != nullptr);
+
+    if (!wnd->is_headless) fprintf(stderr, "DRAW\n");
+
+    display_draw(wnd, progress->ram, progress->dirty);
+}
+
+/**
+*   @brief Executes the program once from "progress->pc" up to "HLT" or the end of "progress->program" by translated code.
+*   @brief Commands which translated code can't execute (DRAW, IN, OUT...) are executed by "execution_step()".
+*
+*   @param progress [in]  - "cpu_store" contains all information about program
+*   @param jit      [in]  - translated program
+*   @param wnd      [in]  - window to draw RAM in
+*   @param is_hlt   [out] - becomes true after "HLT"
+*
+*   @return true if there are not any errors and false else
+*
+*/
+
+bool execution_jit(cpu_store *progress, jit_code *jit, display &wnd, bool &is_hlt)
+{
+    assert(progress != nullptr);
+    assert(jit      != nullptr);
+
+    while (true)
+    {
+        jit_result result = jit_run(jit, progress);
+
+        switch (result.exit)
+        {
+            case JIT_STEP:
+                if (!execution_step(progress, wnd, is_hlt)) return false;
+                break;
+
+            case JIT_GROW:
+                stack_reserve(&progress->stk  , 2 * progress->stk.capacity);
+                stack_reserve(&progress->calls, 2 * progress->calls.capacity);
+                break;
+
+            case JIT_HALT:
+                is_hlt = true;
+                return true;
+
+            case JIT_END:
+                return true;
+
+            default:
+                output_error((ERRORS) result.error);
+                return false;
+        }
+    }
+}
+
+/**
+*   @brief Executes one instruction "progress->pc" by the interpreter.
+*
+*   @param progress [in]  - "cpu_store" contains all information about program
+*   @param wnd      [in]  - window to draw RAM in
+*   @param is_hlt   [out] - becomes true after "HLT"
+*
+*   @return true if there are not any errors and false else
+*/
+
+bool execution_step(cpu_store *progress, display &wnd, bool &is_hlt)
+{
+    assert(progress != nullptr);
+
+    const bool CHECKED = true;
+
+    const instruction *cur = progress->program.cmds + progress->pc++;
+
+    #define DEF_CMD(name, number, code)                                     \
+            case CMD_##name:                                                \
+                code                                                        \
+                break;
+
+    #define DEF_JMP_CMD(name, number, cmp)                                  \
+            case CMD_##name:                                                \
+            {                                                               \
+                GET_STK_TWO()                                               \
+                if (approx_cmp(b, a, #cmp)) cmd_jmp(progress, cur);         \
+                break;                                                      \
+            }
+
+    switch (cur->handler)
+    {
+        #include "cmd.h"
+        default:
+            output_error(UNDEFINED_CMD);
+            return false;
+    }
+    #undef DEF_CMD
+    #undef DEF_JMP_CMD
+
+    return true;
+}
+
+/**
+*   @brief Executes the container once from the beginning up to "HLT" or the end of the machine code.
+*   @brief Every command of the current block is executed by "execution_step()". Jumps out of the block lead to its
+*   @brief CMD_NOT_EXICTING instructions which keep the target positions, then the block with the target is taken by "gdz_seek()".
+*   @brief "CALL" and "RET" keep positions in the machine code in "progress->calls" instead of indexes of instructions.
+*
+*   @param progress [in]  - "cpu_store" contains all information about program
+*   @param wnd      [in]  - window to draw RAM in
+*   @param is_hlt   [out] - becomes true after "HLT"
+*
+*   @return true if there are not any errors and false else
+*/
+
+bool execution_stream(cpu_store *progress, display &wnd, bool &is_hlt)
+{
+    assert(progress         != nullptr);
+    assert(progress->stream != nullptr);
+
+    int pos = sizeof(header);
+
+    while (is_hlt == false)
     {
-        sf::Event event;
-        check_event();
+        if ((size_t) pos == progress->stream->raw_size) return true;
+
+        const gdz_code *code = gdz_seek(progress->stream, pos, &progress->pc);
+        if (code == nullptr)
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "./CPU: there is no command at the position %d of the machine code\n", pos);
+            return false;
+        }
+        progress->program = code->program;
 
-        progress->execution.machine_pos = sizeof(header);
-        while (progress->execution.machine_pos < progress->execution_size && is_hlt == false)
+        while (is_hlt == false)
         {
-            unsigned char cmd = *(unsigned char *) get_machine_cmd(progress, sizeof(char));
-
-            #define DEF_CMD(name, number, code)                                 \
-                    case CMD_##name:                                            \
-                        code                                                    \
-                        break;
-
-            #define DEF_JMP_CMD(name, number, cmp)                              \
-                    case CMD_##name:                                            \
-                    {                                                           \
-                        GET_STK_TWO()                                           \
-                        if (approx_cmp(b, a, #cmp)) cmd_jmp(progress);          \
-                        else progress->execution.machine_pos += sizeof(int);    \
-                        break;                                                  \
-                    }
-                
-            switch ((cmd & mask01))
+            const instruction *cur = progress->program.cmds + progress->pc;
+
+            if (cur->handler == CMD_NOT_EXICTING)
+            {
+                pos = (int) cur->val;
+                break;
+            }
+            if (cur->handler == CMD_CALL)
             {
-                #include "cmd.h"
-                default:
-                    output_error(UNDEFINED_CMD);
+                stack_push(&progress->calls, code->cmd_pos[progress->pc + 1]);
+                progress->pc = cur->jmp;
+                continue;
+            }
+            if (cur->handler == CMD_RET)
+            {
+                if (stack_empty(&progress->calls))
+                {
+                    output_error(EMPTY_CALLS);
                     return false;
+                }
+                pos = stack_front(&progress->calls);
+                stack_pop(&progress->calls);
+                break;
             }
-            #undef DEF_CMD
-            #undef DEF_JMP_CMD
 
-            check_event();
-            //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-            // fprintf(stderr, "is_hlt = %d\n", is_hlt);
-            //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+            if (!execution_step(progress, wnd, is_hlt)) return false;
         }
     }
 
@@ -241,72 +670,106 @@ bool execution(cpu_store *progress)
 }
 
 /**
-*   @brief Reads another command or argument from "progress->execution.machine_code".
+*   @brief Executes the program once by "execution_switch()" and once by "execution_jit()".
+*   @brief Compares RAM, registers and stack size after both executions and prints the result in stderr.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
-*   @param val_size [in] - size (in bytes) of value to read
+*   @param jit      [in] - translated program
+*   @param wnd      [in] - window to draw RAM in
+*
+*   @return true if both executions are correct and their results are equal and false else
 *
-*   @return pointer to the value
+*   @note numbers read by "IN" in the first execution are replayed to the second one, only the second one writes "OUT"
 */
 
-void *get_machine_cmd(cpu_store *const progress, const size_t val_size)
+bool jit_check(cpu_store *progress, jit_code *jit, display &wnd)
 {
     assert(progress != nullptr);
+    assert(jit      != nullptr);
 
-    void *cmd = (char *) progress->execution.machine_code + progress->execution.machine_pos;
-    progress->execution.machine_pos += val_size;
+    cpu_store *check = (cpu_store *) calloc(1, sizeof(cpu_store));
+    assert(check != nullptr);
 
-    return cmd;
-}
+    check->program = progress->program;
+    check->io      = progress->io;
+    memset(check->dirty, 1, sizeof(check->dirty));
+    stack_ctor(&check->stk);
+    stack_ctor(&check->calls);
 
-void cmd_draw(sf::RenderWindow *wnd, cpu_store *progress)
-{
-    fprintf(stderr, "DRAW\n");
+    bool is_hlt_check = false;
+    bool is_hlt       = false;
 
-    unsigned int int_ram[WIDTH*HEIGHT] = {};
+    vm_io_mode(progress->io, VM_IO_RECORD);
+    bool status = execution_switch<true>(check, wnd, is_hlt_check);
 
-    for (int cnt = 0; cnt < WIDTH * HEIGHT; ++cnt) int_ram[cnt] = (unsigned int) progress->ram[cnt];
+    vm_io_mode(progress->io, VM_IO_REPLAY);
+    status = status && execution_jit(progress, jit, wnd, is_hlt);
 
-    sf::Texture tx;
-    tx.create(WIDTH, HEIGHT);
-    tx.update((sf::Uint8 *) int_ram, WIDTH, HEIGHT, 0, 0);
+    vm_io_mode(progress->io, VM_IO_DIRECT);
 
-    sf::Sprite sprite(tx);
-    sprite.setPosition(0, 0);
+    if (status)
+    {
+        int ram_diff = 0;
+        int reg_diff = 0;
+
+        for (int ram_cnt = 0; ram_cnt < RAM_NUM; ++ram_cnt)
+        {
+            if (check->ram[ram_cnt] == progress->ram[ram_cnt]) continue;
 
-    //wnd.clear(sf::Color::Black);
-    (*wnd).draw(sprite);
-    (*wnd).display();
+            if (ram_diff == 0) fprintf(stderr, "JIT CHECK: ram[%d] = %llu, but %llu is expected\n", ram_cnt, progress->ram[ram_cnt], check->ram[ram_cnt]);
+            ++ram_diff;
+        }
+        for (int reg_cnt = 1; reg_cnt <= REG_NUM; ++reg_cnt)
+        {
+            if (check->regs[reg_cnt] == progress->regs[reg_cnt]) continue;
+
+            fprintf(stderr, "JIT CHECK: register %d = %llu, but %llu is expected\n", reg_cnt, progress->regs[reg_cnt], check->regs[reg_cnt]);
+            ++reg_diff;
+        }
+        if (check->stk.size != progress->stk.size)
+        {
+            fprintf(stderr, "JIT CHECK: stack size = %zu, but %zu is expected\n", progress->stk.size, check->stk.size);
+            status = false;
+        }
+
+        if (ram_diff != 0 || reg_diff != 0) status = false;
+
+        if (status) fprintf(stderr, GREEN "JIT CHECK: RAM and registers are equal\n" CANCEL);
+        else        fprintf(stderr, RED   "JIT CHECK: " CANCEL "%d RAM cells and %d registers are different\n", ram_diff, reg_diff);
+    }
+
+    stack_dtor(&check->stk);
+    stack_dtor(&check->calls);
+    free(check);
+
+    return status;
 }
 
 /**
 *   @brief Executes "push" command.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
+*   @param cur      [in] - instruction to execute
 *
 *   @return enum "ERRORS" error value
 */
 
-ERRORS cmd_push(cpu_store *progress)
+ERRORS cmd_push(cpu_store *progress, const instruction *cur)
 {
-    //fprintf(stderr, "PUSH\n");
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
-    --progress->execution.machine_pos;
-    unsigned char cmd = *(unsigned char *) get_machine_cmd(progress, sizeof(char));
-
-    if (cmd & CMD_MEM_ARG)
+    if (cur->cmd & CMD_MEM_ARG)
     {
-        long ram_index = get_memory_val(progress, cmd);
+        long ram_index = get_memory_val(progress, cur);
 
-        if (ram_index >= RAM_NUM) return MEMORY_LIMIT;
+        if ((stack_el) ram_index >= (stack_el) RAM_NUM) return MEMORY_LIMIT;     // negative indices too
         
-        stack_push(&progress->stk, &progress->ram[ram_index]);
+        stack_push(&progress->stk, progress->ram[ram_index]);
         return OK;
     }
     
-    stack_el push_val = get_stack_el_val(progress, cmd);
-    stack_push(&progress->stk, &push_val);
+    stack_push(&progress->stk, get_stack_el_val(progress, cur));
 
     return OK;
 }
@@ -315,158 +778,310 @@ ERRORS cmd_push(cpu_store *progress)
 *   @brief Executes "pop" command.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
+*   @param cur      [in] - instruction to execute
 *
 *   @return enum "ERRORS" error value
 */
 
-ERRORS cmd_pop(cpu_store *progress)
+ERRORS cmd_pop(cpu_store *progress, const instruction *cur)
 {
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
     if (stack_empty(&progress->stk)) return EMPTY_STACK;
 
-    --progress->execution.machine_pos;
-    unsigned char cmd = *(unsigned char *) get_machine_cmd(progress, sizeof(char));
-    
-    if (cmd & CMD_MEM_ARG)
+    if (cur->cmd & CMD_MEM_ARG)
     {
-        long ram_index = get_memory_val(progress, cmd);
+        long ram_index = get_memory_val(progress, cur);
 
-        if (ram_index >= RAM_NUM) return MEMORY_LIMIT;
+        if ((stack_el) ram_index >= (stack_el) RAM_NUM) return MEMORY_LIMIT;     // negative indices too
 
-        progress->ram[ram_index] = *(stack_el *) stack_front(&progress->stk);
-        stack_pop(&progress->stk);
+        progress->ram  [ram_index]                = stack_pop(&progress->stk);
+        progress->dirty[ram_index >> DIRTY_SHIFT] = 1;
         
         return OK;
     }
-    if (cmd & CMD_REG_ARG)
+    if (cur->cmd & CMD_REG_ARG)
     {
-        char reg_pos = *(char *) get_machine_cmd(progress, sizeof(char));
-        if (reg_pos <= REG_NUM / 2) progress->long_regs[reg_pos] = (long) *(stack_el *) stack_front(&progress->stk);
-        else
-        {
-            reg_pos -= 5; //5 - number of long-type registers
-            progress->regs[reg_pos] = *(stack_el *) stack_front(&progress->stk);
-        }
-        stack_pop(&progress->stk);
+        progress->regs[cur->reg] = stack_pop(&progress->stk);
 
         return OK;
     }
-    if (cmd & CMD_NUM_ARG)
+    if (cur->cmd & CMD_NUM_ARG)
     {
         stack_pop(&progress->stk);
     }
     return OK;
 }
 
-ERRORS cmd_push_many(cpu_store *progress)
+ERRORS cmd_push_many(cpu_store *progress, const instruction *cur)
 {
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
-    long number = *(long *) get_machine_cmd(progress, sizeof(long));
-
-    while (number--)
+    for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt)
     {
-        stack_el val = *(stack_el *) get_machine_cmd(progress, sizeof(stack_el));
-        stack_push(&progress->stk, &val);
+        stack_push(&progress->stk, cur->data[val_cnt]);
     }
 
     return OK;
 }
 
-ERRORS cmd_pop_many(cpu_store *progress)
+ERRORS cmd_pop_many(cpu_store *progress, const instruction *cur)
 {
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
-    long number = *(long *) get_machine_cmd(progress, sizeof(long));
-
-    while (number--)
+    for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt)
     {
-        long ram_index = *(long *) get_machine_cmd(progress, sizeof(long));
+        if (cur->data[val_cnt] >= (stack_el) RAM_NUM) return MEMORY_LIMIT;
+
+        long ram_index = (long) cur->data[val_cnt];
         
         if (stack_empty(&progress->stk)) return EMPTY_STACK;
 
-        progress->ram[ram_index] = *(stack_el *) stack_front(&progress->stk);
-        stack_pop(&progress->stk);
+        progress->ram  [ram_index]                = stack_pop(&progress->stk);
+        progress->dirty[ram_index >> DIRTY_SHIFT] = 1;
     }
     return OK;
 }
 
 /**
-*   @brief Gets number which means the index of cell in ram_memory consisting of long-register or long-number.
+*   @brief Executes "blit" command: writes the runs of its spans (see "decode.h") in RAM and marks their chunks as changed.
+*   @brief The decoder has checked that the spans are whole, so only the end of every run is checked against RAM_NUM.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
-*   @param cmd      [in] - coomand containing information about arguments
+*   @param cur      [in] - instruction to execute
 *
-*   @return number which means the index of cell in ram_memory
+*   @return enum "ERRORS" error value
 */
 
-long get_memory_val(cpu_store *const progress, const unsigned char cmd)
+ERRORS cmd_blit(cpu_store *progress, const instruction *cur)
 {
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
-    long ram_index = 0;
-    if (cmd & CMD_REG_ARG) ram_index += get_reg_val(progress, *(char *) get_machine_cmd(progress, sizeof(char)));
-    if (cmd & CMD_NUM_ARG) ram_index +=                       *(long *) get_machine_cmd(progress, sizeof(long));
+    const stack_el *val = cur->data;
+    const stack_el *end = cur->data + cur->val;
 
-    return ram_index;
+    stack_el ram_pos = 0;
+
+    while (val != end)
+    {
+        stack_el skip    = *val++;
+        stack_el run_num = *val++;
+
+        if (skip > RAM_NUM - ram_pos) return MEMORY_LIMIT;
+        ram_pos += skip;
+
+        stack_el span_begin = ram_pos;
+
+        for (stack_el run_cnt = 0; run_cnt < run_num; ++run_cnt)
+        {
+            stack_el len   = *val++;
+            stack_el color = *val++;
+
+            if (len > RAM_NUM - ram_pos) return MEMORY_LIMIT;
+
+            stack_el *cell = progress->ram + ram_pos;
+            for (stack_el cell_cnt = 0; cell_cnt < len; ++cell_cnt) cell[cell_cnt] = color;
+
+            ram_pos += len;
+        }
+
+        mark_dirty(progress, span_begin, ram_pos);
+    }
+
+    return OK;
 }
 
 /**
-*   @brief Gets stack_el-value consisting of long-register or long-number.
+*   @brief Executes "memset" command: pops the value, the number of cells and the first cell and fills the cells with the value.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
-*   @param cmd      [in] - coomand containing information about arguments
 *
-*   @return stack_el-value
+*   @return enum "ERRORS" error value
 */
 
-stack_el get_stack_el_val(cpu_store *progress, const unsigned char cmd)
+ERRORS cmd_memset(cpu_store *progress)
 {
     assert(progress != nullptr);
 
-    stack_el val = 0;
-    if (cmd & CMD_REG_ARG) val += get_reg_val(progress, *(char *)     get_machine_cmd(progress, sizeof(char)));
-    if (cmd & CMD_NUM_ARG) val +=                       *(stack_el *) get_machine_cmd(progress, sizeof(stack_el));
+    if (progress->stk.size < 3) return EMPTY_STACK;
 
-    return val;
+    stack_el val   = stack_pop(&progress->stk);
+    stack_el count = stack_pop(&progress->stk);
+    stack_el dst   = stack_pop(&progress->stk);
+
+    if (dst > RAM_NUM || count > RAM_NUM - dst) return MEMORY_LIMIT;
+
+    fill_cells(progress, dst, count, val);
+
+    return OK;
 }
 
 /**
-*   @brief Gets value from "*progress" registers by the register number.
+*   @brief Executes "memcpy" command: pops the number of cells, the first source cell and the first destination cell
+*   @brief and copies the cells. The ranges can overlap, the result is the same as if the source was copied to a buffer first.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
-*   @param reg_num  [in] - number of register to take the value from
 *
-*   @return value from the register
+*   @return enum "ERRORS" error value
 */
 
-stack_el get_reg_val(cpu_store *const progress, const char reg_num)
+ERRORS cmd_memcpy(cpu_store *progress)
 {
     assert(progress != nullptr);
 
-    if (reg_num <= REG_NUM / 2) return progress->long_regs[reg_num];
-    else                        return progress->regs     [reg_num - 5];
+    if (progress->stk.size < 3) return EMPTY_STACK;
+
+    stack_el count = stack_pop(&progress->stk);
+    stack_el src   = stack_pop(&progress->stk);
+    stack_el dst   = stack_pop(&progress->stk);
+
+    if (src > RAM_NUM || dst > RAM_NUM || count > RAM_NUM - src || count > RAM_NUM - dst) return MEMORY_LIMIT;
+
+    memmove(progress->ram + dst, progress->ram + src, count * sizeof(stack_el));
+    mark_dirty(progress, dst, dst + count);
+
+    return OK;
+}
+
+/**
+*   @brief Executes "fill_rect" command: pops the value, the distance between the first cells of the rows (stride),
+*   @brief the number of rows, the number of cells in a row and the first cell and fills the rows with the value.
+*   @brief The whole rectangle is checked against RAM_NUM once before filling.
+*
+*   @param progress [in] - "cpu_store" contains all information about program
+*
+*   @return enum "ERRORS" error value
+*/
+
+ERRORS cmd_fill_rect(cpu_store *progress)
+{
+    assert(progress != nullptr);
+
+    if (progress->stk.size < 5) return EMPTY_STACK;
+
+    stack_el val    = stack_pop(&progress->stk);
+    stack_el stride = stack_pop(&progress->stk);
+    stack_el height = stack_pop(&progress->stk);
+    stack_el width  = stack_pop(&progress->stk);
+    stack_el dst    = stack_pop(&progress->stk);
+
+    if (width == 0 || height == 0) return OK;
+    if (stride == 0) height = 1;    // all the rows are the same cells
+
+    if (dst > RAM_NUM || width > RAM_NUM - dst)                         return MEMORY_LIMIT;
+    if (height > 1 && stride > (RAM_NUM - dst - width) / (height - 1))  return MEMORY_LIMIT;   // the last row ends in RAM
+
+    for (stack_el row_cnt = 0; row_cnt < height; ++row_cnt) fill_cells(progress, dst + row_cnt * stride, width, val);
+
+    return OK;
+}
+
+/**
+*   @brief Fills "count" cells of RAM from "begin" with "val" and marks their chunks as changed.
+*   @brief The first cells are filled one by one, then the filled part is doubled by "memcpy()".
+*/
+
+void fill_cells(cpu_store *progress, const stack_el begin, const stack_el count, const stack_el val)
+{
+    assert(progress != nullptr);
+
+    if (count == 0) return;
+
+    const stack_el FILL_MIN = 16;
+
+    stack_el *cell   = progress->ram + begin;
+    stack_el  filled = (count < FILL_MIN) ? count : FILL_MIN;
+
+    for (stack_el cell_cnt = 0; cell_cnt < filled; ++cell_cnt) cell[cell_cnt] = val;
+
+    while (filled < count)
+    {
+        stack_el copy_num = (count - filled < filled) ? count - filled : filled;
+
+        memcpy(cell + filled, cell, copy_num * sizeof(stack_el));
+        filled += copy_num;
+    }
+
+    mark_dirty(progress, begin, begin + count);
+}
+
+/**
+*   @brief Marks the chunks of RAM cells from "begin" to "end" (not including) as changed.
+*/
+
+void mark_dirty(cpu_store *progress, const stack_el begin, const stack_el end)
+{
+    assert(progress != nullptr);
+
+    if (begin == end) return;
+
+    stack_el chunk_begin = begin     >> DIRTY_SHIFT;
+    stack_el chunk_end   = (end - 1) >> DIRTY_SHIFT;
+
+    memset(progress->dirty + chunk_begin, 1, chunk_end - chunk_begin + 1);
+}
+
+/**
+*   @brief Gets number which means the index of cell in ram_memory consisting of long-register or long-number.
+*
+*   @param progress [in] - "cpu_store" contains all information about program
+*   @param cur      [in] - instruction containing information about arguments
+*
+*   @return number which means the index of cell in ram_memory
+*/
+
+long get_memory_val(cpu_store *const progress, const instruction *cur)
+{
+    assert(progress != nullptr);
+    assert(cur      != nullptr);
+
+    long ram_index = 0;
+    if (cur->cmd & CMD_REG_ARG) ram_index += (long) progress->regs[cur->reg];
+    if (cur->cmd & CMD_NUM_ARG) ram_index += (long) cur->val;
+
+    return ram_index;
+}
+
+/**
+*   @brief Gets stack_el-value consisting of long-register or long-number.
+*
+*   @param progress [in] - "cpu_store" contains all information about program
+*   @param cur      [in] - instruction containing information about arguments
+*
+*   @return stack_el-value
+*/
+
+stack_el get_stack_el_val(cpu_store *progress, const instruction *cur)
+{
+    assert(progress != nullptr);
+    assert(cur      != nullptr);
+
+    stack_el val = 0;
+    if (cur->cmd & CMD_REG_ARG) val += progress->regs[cur->reg];
+    if (cur->cmd & CMD_NUM_ARG) val += cur->val;
+
+    return val;
 }
 
 /**
 *   @brief Executes "jmp" command.
 *
 *   @param progress [in] - "cpu_store" contains all information about program
+*   @param cur      [in] - instruction to execute
 *
 *   @return enum "ERRORS" error value
 */
 
-ERRORS cmd_jmp(cpu_store *progress)
+ERRORS cmd_jmp(cpu_store *progress, const instruction *cur)
 {
-    //fprintf(stderr, "JMP\n");
     assert(progress != nullptr);
+    assert(cur      != nullptr);
 
-    int jmp_pos = *(int *) get_machine_cmd(progress, sizeof(int));
-    //-----------
-    //fprintf(stderr, "jmp_pos = %d\n", jmp_pos);
-    //-----------
-    progress->execution.machine_pos = jmp_pos;
+    progress->pc = cur->jmp;
 
     return OK;
 }
@@ -483,6 +1098,12 @@ bool check_signature(cpu_store *progress)
 {
     assert(progress != nullptr);
 
+    if (progress->execution_size < sizeof(header))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "./CPU: The file is too small to contain the signature\n");
+        return false;
+    }
+
     header signature = *(header *) progress->execution.machine_code;
     //------------
     //fprintf(stderr, "signature.cmd_num = %d\n", signature.cmd_num);
@@ -499,7 +1120,7 @@ bool check_signature(cpu_store *progress)
                         "Maybe it means that the source file has any errors\n");
         return false;
     }
-    if ((progress->version = signature.version) < 1 || progress->version > 2)
+    if ((progress->version = signature.version) < 1 || progress->version > GD_VERSION_MAX)
     {
         fprintf(stderr, RED "ERROR: " CANCEL "./CPU doesn't support the version %d\n", signature.version);
         return false;
@@ -510,6 +1131,29 @@ bool check_signature(cpu_store *progress)
     return true;
 }
 
+/**
+*   @brief Optimizes the decoded program by "optimize_program()" before the verification and the execution
+*   @brief and prints the numbers of the commands in stderr.
+*
+*   @param progress [in][out] - "cpu_store" contains all information about program
+*/
+
+void optimize_loaded(cpu_store *progress)
+{
+    assert(progress != nullptr);
+
+    opt_report report = {};
+    optimize_program(&progress->program, nullptr, 0, INLINE_BUDGET, &report);
+
+    fprintf(stderr, "--optimize: %d -> %d commands (%+d): %d added by inlining, %d tail calls, %d registers replaced by constants, "
+                    "%d dead \"pop reg\", %d unreachable, %d folded, %d folded jumps, %d push/pop pairs, %d jumps to the next command, %d jump chains\n",
+                    report.cmd_num, progress->program.size, progress->program.size - report.cmd_num, report.inline_added, report.tail_calls,
+                    report.const_regs, report.dead_pops, report.unreachable, report.folded, report.jcc_folded, report.push_pop, report.jmp_next,
+                    report.jmp_chains);
+
+    opt_report_dtor(&report);
+}
+
 /**
 *   @brief Prints error-messages in stderr.
 *
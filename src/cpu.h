@@ -0,0 +1,56 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stddef.h>
+
+#include "stack.h"
+#include "machine.h"
+#include "decode.h"
+#include "vm_io.h"
+
+struct gdz_stream;
+
+const int REG_NUM =       8;
+const int WIDTH   =     960;
+const int HEIGHT  =     720;
+const int RAM_NUM = 960*720;
+const int RAM_STR =     100;
+
+const int DIRTY_SHIFT = 10;                             // RAM is divided into chunks of (1 << DIRTY_SHIFT) cells
+const int DIRTY_NUM   = (RAM_NUM >> DIRTY_SHIFT) + 1;
+
+struct cpu_store
+{
+    machine execution;
+    size_t  execution_size;
+
+    char version;
+
+    decoded program;
+    bool    is_verified;    // the program can't pop from empty stacks, so the interpreter doesn't check them
+    int     pc;
+
+    gdz_stream *stream;         // container executed by blocks, nullptr if the program is decoded at once
+
+    vm_io *io;                  // input and output of "IN" and "OUT"
+
+    stack<int>      calls;
+    stack<stack_el> stk;
+    stack_el ram [RAM_NUM];
+    stack_el regs[REG_NUM + 1]; //zero register is invalid, 1-4 are "long"-type, 5-8 are "double"-type
+
+    unsigned char dirty[DIRTY_NUM]; //dirty[i] != 0 if the chunk i of RAM is changed since the last "DRAW"
+};
+
+enum ERRORS
+{
+    OK            ,
+    ZERO_DIVISION ,
+    EMPTY_STACK   ,
+    EMPTY_CALLS   ,
+    UNDEFINED_CMD ,
+    MEMORY_LIMIT  ,
+    NEG_VALUE
+};
+
+#endif //CPU_H
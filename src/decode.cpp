@@ -0,0 +1,772 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+#include "decode.h"
+
+const int    REG_NUM    = 8;
+const int    VARINT_MAX = 9;    // bytes of the longest varint
+const size_t VALUES_MIN = 256;  // initial capacity of the values of PUSH_MANY, POP_MANY and BLIT of GD v3
+const size_t CMDS_MIN   = 1024; // initial capacity of the instructions, it doubles when it is spent
+
+/*
+ * Values of PUSH_MANY, POP_MANY and BLIT unpacked from GD v3. Instructions keep offsets of their values
+ * while the array grows, the offsets become pointers when the whole machine code is decoded.
+ */
+
+struct value_pool
+{
+    stack_el *data;
+
+    size_t size;
+    size_t capacity;
+};
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static bool     decode_cmds     (const char *code, const size_t size, const int base, const char version, decoded *const program,
+                                 int **cmd_pos, int **jmp_pos);
+static void     grow_cmds       (decoded *const program, int **cmd_pos, int **jmp_pos, size_t *const capacity);
+static bool     decode_cmd      (const char *code, const size_t size, const char version, const int base, size_t *const pos,
+                                 instruction *const cur, int *const jmp_pos, value_pool *const pool);
+static bool     decode_reg      (const char *code, const size_t size, size_t *const pos, instruction *const cur);
+static bool     decode_val      (const char *code, const size_t size, const char version, size_t *const pos, instruction *const cur);
+static bool     decode_many     (const char *code, const size_t size, size_t *const pos, instruction *const cur,
+                                 int *const val_offset, value_pool *const pool);
+static bool     is_spans        (const stack_el *data, const stack_el val_num);
+static bool     is_cmd          (const unsigned char handler);
+static bool     is_jmp_cmd      (const unsigned char handler);
+static bool     is_many_cmd     (const unsigned char handler);
+static int      find_cmd_index  (const int  *cmd_pos, const int cmd_num, const int machine_pos);
+static int      encode_size     (const instruction *cur, const char version);
+static char    *encode_val      (char *code, const stack_el val, const char version);
+
+static bool     read_varint     (const char *code, const size_t size, size_t *const pos, stack_el *const val);
+static void     write_varint    (char *code, stack_el val, const int len);
+static int      varint_size     (const stack_el val);
+static stack_el zigzag_encode   (const stack_el val);
+static stack_el zigzag_decode   (const stack_el val);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Translates "machine code" (commands after the header) to the array of fixed-width instructions.
+*   @brief Reads arguments of every command once, turns register numbers into register slots and jump positions into instruction indices.
+*   @brief Puts the instruction CMD_NOT_EXICTING after the last command so that executing never runs out of "program->cmds".
+*   @brief Values of PUSH_MANY, POP_MANY and BLIT of v1 and v2 are not copied, "data" points to "machine code".
+*
+*   @param machine_code [in]  - "machine code" with the header
+*   @param machine_size [in]  - size (in bytes) of "machine code" with the header
+*   @param version      [in]  - version of "machine code" from its header
+*   @param program      [out] - pointer to the "decoded" to put instructions in
+*
+*   @return true if "machine code" is correct and false else
+*/
+
+bool decode_program(const void *machine_code, const size_t machine_size, const char version, decoded *const program)
+{
+    assert(machine_code != nullptr);
+    assert(program      != nullptr);
+
+    int *cmd_pos = nullptr;
+    int *jmp_pos = nullptr;
+
+    if (!decode_cmds((const char *) machine_code + sizeof(header), machine_size - sizeof(header), sizeof(header), version,
+                     program, &cmd_pos, &jmp_pos)) return false;
+
+    bool is_ok = true;
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        if (!is_jmp_cmd(program->cmds[cmd_cnt].handler)) continue;
+
+        int jmp_index = find_cmd_index(cmd_pos, program->size + 1, jmp_pos[cmd_cnt]);
+        if (jmp_index == -1)
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "./CPU: the command at the position %d jumps to %d which is not a command\n",
+                            cmd_pos[cmd_cnt], jmp_pos[cmd_cnt]);
+            is_ok = false;
+        }
+        program->cmds[cmd_cnt].jmp = jmp_index;
+    }
+
+    free(cmd_pos);
+    free(jmp_pos);
+
+    if (!is_ok) decode_dtor(program);
+    return is_ok;
+}
+
+/**
+*   @brief Translates the block of whole commands of "machine code" (see "gdz.h") to instructions like "decode_program()" does.
+*   @brief Jumps out of the block (and to the end of it) lead to the instructions CMD_NOT_EXICTING after the last one,
+*   @brief "val" of them is the position to jump to. "val" of the final instruction is the position of the end of the block.
+*
+*   @param block      [in]  - commands of the block
+*   @param block_size [in]  - size (in bytes) of the block
+*   @param block_pos  [in]  - position of the block in "machine code"
+*   @param version    [in]  - version of "machine code" from its header
+*   @param program    [out] - pointer to the "decoded" to put instructions in
+*   @param cmd_pos    [out] - "program->size + 1" positions in "machine code": of every instruction and of the end of the block
+*
+*   @return true if the block is correct and false else
+*/
+
+bool decode_block(const void *block, const size_t block_size, const int block_pos, const char version, decoded *const program, int **cmd_pos)
+{
+    assert(block   != nullptr);
+    assert(program != nullptr);
+    assert(cmd_pos != nullptr);
+
+    int *jmp_pos = nullptr;
+    if (!decode_cmds((const char *) block, block_size, block_pos, version, program, cmd_pos, &jmp_pos)) return false;
+
+    int far_num = 0;
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        if (!is_jmp_cmd(program->cmds[cmd_cnt].handler)) continue;
+
+        int jmp_index = find_cmd_index(*cmd_pos, program->size, jmp_pos[cmd_cnt]);
+        if (jmp_index == -1) ++far_num;
+
+        program->cmds[cmd_cnt].jmp = jmp_index;
+    }
+
+    program->cmds = (instruction *) realloc(program->cmds, (program->size + 1 + far_num) * sizeof(instruction));
+    assert(program->cmds != nullptr);
+
+    program->cmds[program->size].val = (stack_el) (*cmd_pos)[program->size];
+
+    int far_cnt = program->size + 1;
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (!is_jmp_cmd(cur->handler) || cur->jmp != -1) continue;
+
+        program->cmds[far_cnt]         = {};
+        program->cmds[far_cnt].handler = CMD_NOT_EXICTING;
+        program->cmds[far_cnt].cmd     = CMD_NOT_EXICTING;
+        program->cmds[far_cnt].val     = (stack_el) jmp_pos[cmd_cnt];
+        cur->jmp = far_cnt++;
+    }
+
+    free(jmp_pos);
+
+    return true;
+}
+
+/**
+*   @brief Decodes all the commands of "code" and puts CMD_NOT_EXICTING after them. Jumps are not resolved.
+*   @brief The arrays grow with the number of decoded commands, so their size doesn't depend on the size of arguments.
+*
+*   @param code    [in]  - commands
+*   @param size    [in]  - size (in bytes) of the commands
+*   @param base    [in]  - position of "code" in "machine code"
+*   @param version [in]  - version of "machine code"
+*   @param program [out] - pointer to the "decoded" to put instructions in
+*   @param cmd_pos [out] - "program->size + 1" positions in "machine code": of every instruction and of the end of "code"
+*   @param jmp_pos [out] - positions in "machine code" to jump to (for jump commands)
+*
+*   @return true if the commands are correct and false else, "program", "cmd_pos" and "jmp_pos" are freed then
+*/
+
+static bool decode_cmds(const char *code, const size_t size, const int base, const char version, decoded *const program,
+                        int **cmd_pos, int **jmp_pos)
+{
+    size_t capacity = CMDS_MIN;
+
+    program->cmds   = (instruction *) calloc(capacity, sizeof(instruction));
+    program->size   = 0;
+    program->values = nullptr;
+
+    *cmd_pos = (int *) calloc(capacity, sizeof(int));
+    *jmp_pos = (int *) calloc(capacity, sizeof(int));
+
+    assert(program->cmds != nullptr);
+    assert(*cmd_pos      != nullptr);
+    assert(*jmp_pos      != nullptr);
+
+    value_pool pool = {};
+
+    size_t pos = 0;
+    while (pos < size)
+    {
+        if ((size_t) program->size + 1 == capacity) grow_cmds(program, cmd_pos, jmp_pos, &capacity);
+
+        (*cmd_pos)[program->size] = base + (int) pos;
+
+        if (!decode_cmd(code, size, version, base, &pos, program->cmds + program->size, *jmp_pos + program->size, &pool))
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "./CPU: can't decode the command at the position %d\n", (*cmd_pos)[program->size]);
+
+            free(*cmd_pos);
+            free(*jmp_pos);
+            free(pool.data);
+            decode_dtor(program);
+            return false;
+        }
+        ++program->size;
+    }
+
+    program->cmds = (instruction *) realloc(program->cmds, ((size_t) program->size + 1) * sizeof(instruction));
+    *cmd_pos      = (int *)         realloc(*cmd_pos,      ((size_t) program->size + 1) * sizeof(int));
+    assert(program->cmds != nullptr);
+    assert(*cmd_pos      != nullptr);
+
+    (*cmd_pos)[program->size] = base + (int) size;
+
+    program->cmds[program->size]         = {};
+    program->cmds[program->size].handler = CMD_NOT_EXICTING;
+    program->cmds[program->size].cmd     = CMD_NOT_EXICTING;
+    program->values = pool.data;
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size && version >= 3; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (is_many_cmd(cur->handler)) cur->data = pool.data + (*jmp_pos)[cmd_cnt];
+    }
+
+    return true;
+}
+
+/**
+*   @brief Doubles the capacity of the instructions and of their positions.
+*/
+
+static void grow_cmds(decoded *const program, int **cmd_pos, int **jmp_pos, size_t *const capacity)
+{
+    assert(program  != nullptr);
+    assert(cmd_pos  != nullptr);
+    assert(jmp_pos  != nullptr);
+    assert(capacity != nullptr);
+
+    *capacity *= 2;
+
+    program->cmds = (instruction *) realloc(program->cmds, *capacity * sizeof(instruction));
+    *cmd_pos      = (int *)         realloc(*cmd_pos,      *capacity * sizeof(int));
+    *jmp_pos      = (int *)         realloc(*jmp_pos,      *capacity * sizeof(int));
+
+    assert(program->cmds != nullptr);
+    assert(*cmd_pos      != nullptr);
+    assert(*jmp_pos      != nullptr);
+}
+
+void decode_dtor(decoded *const program)
+{
+    assert(program != nullptr);
+
+    free(program->cmds);
+    free(program->values);
+    *program = {};
+}
+
+/**
+*   @brief Decodes one command and its arguments.
+*
+*   @param code    [in]      - "machine code"
+*   @param size    [in]      - size (in bytes) of "machine code"
+*   @param version [in]      - version of "machine code"
+*   @param base    [in]      - position of "code" in "machine code"
+*   @param pos     [in][out] - position of the command in "code", becomes position of the next command
+*   @param cur     [out]     - instruction to fill
+*   @param jmp_pos [out]     - position to jump to (for jump commands), offset of the values in "pool" (for PUSH_MANY, POP_MANY and BLIT of v3)
+*   @param pool    [in][out] - values of PUSH_MANY, POP_MANY and BLIT of v3
+*
+*   @return true if the command is correct and false else
+*/
+
+static bool decode_cmd(const char *code, const size_t size, const char version, const int base, size_t *const pos,
+                       instruction *const cur, int *const jmp_pos, value_pool *const pool)
+{
+    assert(code    != nullptr);
+    assert(pos     != nullptr);
+    assert(cur     != nullptr);
+    assert(jmp_pos != nullptr);
+    assert(pool    != nullptr);
+
+    int cmd_pos  = base + (int) *pos;
+
+    *cur = {};
+    cur->cmd     = (unsigned char) code[(*pos)++];
+    cur->handler = cur->cmd & mask01;
+
+    switch (cur->handler)
+    {
+        case CMD_PUSH:
+            if (!(cur->cmd & (CMD_REG_ARG | CMD_NUM_ARG))) return false;
+            return decode_reg(code, size, pos, cur) && decode_val(code, size, version, pos, cur);
+
+        case CMD_POP:
+            if (cur->cmd & CMD_MEM_ARG) return decode_reg(code, size, pos, cur) && decode_val(code, size, version, pos, cur);
+            if (cur->cmd & CMD_REG_ARG) return decode_reg(code, size, pos, cur);
+            return cur->cmd & CMD_NUM_ARG;
+
+        case CMD_JMP: case CMD_JA: case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE: case CMD_JNE: case CMD_CALL:
+            if (version >= 3)
+            {
+                stack_el offset = 0;
+                if (!read_varint(code, size, pos, &offset)) return false;
+
+                *jmp_pos = cmd_pos + (int) zigzag_decode(offset);
+                return true;
+            }
+            if (*pos + sizeof(int) > size) return false;
+
+            memcpy(jmp_pos, code + *pos, sizeof(int));
+            *pos += sizeof(int);
+            return true;
+
+        case CMD_PUSH_MANY:
+        case CMD_POP_MANY:
+        case CMD_BLIT:
+            if (version >= 3)
+            {
+                if (!decode_many(code, size, pos, cur, jmp_pos, pool)) return false;
+                return cur->handler != CMD_BLIT || is_spans(pool->data + *jmp_pos, cur->val);
+            }
+            if (*pos + sizeof(long) > size) return false;
+
+            memcpy(&cur->val, code + *pos, sizeof(long));
+            *pos += sizeof(long);
+
+            if (cur->val > (size - *pos) / sizeof(stack_el)) return false;
+
+            cur->data = (const stack_el *) (code + *pos);
+            *pos += cur->val * sizeof(stack_el);
+
+            return cur->handler != CMD_BLIT || is_spans(cur->data, cur->val);
+
+        case CMD_NOT_EXICTING:
+            return false;
+
+        default:
+            return is_cmd(cur->handler);
+    }
+}
+
+/**
+*   @brief Checks that the values of BLIT consist of whole spans (see "decode.h"), so BLIT never reads after its values.
+*/
+
+static bool is_spans(const stack_el *data, const stack_el val_num)
+{
+    stack_el val_cnt = 0;
+
+    while (val_cnt < val_num)
+    {
+        if (val_num - val_cnt < 2) return false;
+
+        stack_el run_num = data[val_cnt + 1];
+        val_cnt += 2;
+
+        if (run_num > (val_num - val_cnt) / 2) return false;
+        val_cnt += 2 * run_num;
+    }
+
+    return true;
+}
+
+/**
+*   @brief Checks if "handler" is one of the commands from "cmd.h".
+*/
+
+static bool is_cmd(const unsigned char handler)
+{
+    #define DEF_CMD(name, ...)                      \
+            if (handler == CMD_##name) return true;
+    #define DEF_JMP_CMD(name, ...)                  \
+            if (handler == CMD_##name) return true;
+
+    #include "cmd.h"
+    #undef DEF_CMD
+    #undef DEF_JMP_CMD
+
+    return false;
+}
+
+/**
+*   @brief Decodes the register argument if the command has it.
+*
+*   @return true if the register is correct and false else
+*/
+
+static bool decode_reg(const char *code, const size_t size, size_t *const pos, instruction *const cur)
+{
+    if (!(cur->cmd & CMD_REG_ARG)) return true;
+    if (*pos >= size)               return false;
+
+    cur->reg = (unsigned char) code[(*pos)++];
+
+    return cur->reg >= 1 && cur->reg <= REG_NUM;
+}
+
+/**
+*   @brief Decodes the number argument if the command has it.
+*
+*   @return true if the number is inside "machine code" and false else
+*/
+
+static bool decode_val(const char *code, const size_t size, const char version, size_t *const pos, instruction *const cur)
+{
+    if (!(cur->cmd & CMD_NUM_ARG)) return true;
+
+    if (version >= 3)
+    {
+        if (!read_varint(code, size, pos, &cur->val)) return false;
+
+        cur->val = zigzag_decode(cur->val);
+        return true;
+    }
+    if (*pos + sizeof(stack_el) > size) return false;
+
+    memcpy(&cur->val, code + *pos, sizeof(stack_el));
+    *pos += sizeof(stack_el);
+
+    return true;
+}
+
+/**
+*   @brief Decodes the number of values and the values of PUSH_MANY, POP_MANY or BLIT of v3 and appends the values to "pool".
+*
+*   @param val_offset [out] - offset of the first value in "pool"
+*
+*   @return true if the values are inside "machine code" and false else
+*/
+
+static bool decode_many(const char *code, const size_t size, size_t *const pos, instruction *const cur,
+                        int *const val_offset, value_pool *const pool)
+{
+    if (!read_varint(code, size, pos, &cur->val)) return false;
+    if (cur->val > size - *pos)                   return false;   // every value takes at least one byte
+
+    if (pool->size + cur->val > pool->capacity)
+    {
+        size_t new_capacity = (pool->capacity == 0) ? VALUES_MIN : pool->capacity;
+        while (new_capacity < pool->size + cur->val) new_capacity *= 2;
+
+        pool->data     = (stack_el *) realloc(pool->data, new_capacity * sizeof(stack_el));
+        pool->capacity = new_capacity;
+        assert(pool->data != nullptr);
+    }
+
+    *val_offset = (int) pool->size;
+
+    stack_el *values = pool->data + pool->size;
+    for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt)
+    {
+        if (!read_varint(code, size, pos, values + val_cnt)) return false;
+        values[val_cnt] = zigzag_decode(values[val_cnt]);
+    }
+    pool->size += cur->val;
+
+    return true;
+}
+
+/**
+*   @brief Checks if "handler" is a jump command: JMP, CALL or a conditional jump.
+*/
+
+static bool is_jmp_cmd(const unsigned char handler)
+{
+    return handler == CMD_JMP || handler == CMD_CALL || (handler >= CMD_JA && handler <= CMD_JNE);
+}
+
+/**
+*   @brief Checks if "handler" is a command with many values: PUSH_MANY, POP_MANY or BLIT.
+*/
+
+static bool is_many_cmd(const unsigned char handler)
+{
+    return handler == CMD_PUSH_MANY || handler == CMD_POP_MANY || handler == CMD_BLIT;
+}
+
+/**
+*   @brief Finds the index of the command by its position in "machine code" using binary search.
+*
+*   @param cmd_pos     [in] - sorted positions of all commands
+*   @param cmd_num     [in] - number of commands
+*   @param machine_pos [in] - position to find
+*
+*   @return index of the command and -1 if there is no command at "machine_pos"
+*/
+
+static int find_cmd_index(const int *cmd_pos, const int cmd_num, const int machine_pos)
+{
+    assert(cmd_pos != nullptr);
+
+    int left  = 0;
+    int right = cmd_num;
+
+    while (left < right)
+    {
+        int mid = (left + right) / 2;
+
+        if (cmd_pos[mid] < machine_pos) left  = mid + 1;
+        else                            right = mid;
+    }
+
+    if (left < cmd_num && cmd_pos[left] == machine_pos) return left;
+    return -1;
+}
+
+/**
+*   @brief Counts positions of the instructions in "machine code" made by "encode_program()".
+*   @brief Sizes of the v3 jumps depend on the distances to their targets, so they start from one byte and grow
+*   @brief until all the offsets fit. Sizes never decrease, so it ends, a grown jump can keep a longer varint than it needs.
+*
+*   @param program [in]  - decoded program
+*   @param version [in]  - version of "machine code"
+*   @param start   [in]  - position of the first instruction (size of the header)
+*   @param cmd_pos [out] - "program->size + 1" positions: of every instruction and of the end of "machine code"
+*
+*   @return size (in bytes) of "machine code" with the header
+*/
+
+int encode_layout(const decoded *const program, const char version, const int start, int *const cmd_pos)
+{
+    assert(program != nullptr);
+    assert(cmd_pos != nullptr);
+
+    int *cmd_size = (int *) calloc(program->size + 1, sizeof(int));
+    assert(cmd_size != nullptr);
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt) cmd_size[cmd_cnt] = encode_size(program->cmds + cmd_cnt, version);
+
+    bool is_changed = true;
+    while (is_changed)
+    {
+        int pos = start;
+        for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+        {
+            cmd_pos[cmd_cnt] = pos;
+            pos += cmd_size[cmd_cnt];
+        }
+        cmd_pos[program->size] = pos;
+
+        is_changed = false;
+        if (version < 3) break;
+
+        for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+        {
+            const instruction *cur = program->cmds + cmd_cnt;
+            if (!is_jmp_cmd(cur->handler)) continue;
+
+            int need_size = 1 + varint_size(zigzag_encode((stack_el) (cmd_pos[cur->jmp] - cmd_pos[cmd_cnt])));
+            if (need_size > cmd_size[cmd_cnt])
+            {
+                cmd_size[cmd_cnt] = need_size;
+                is_changed        = true;
+            }
+        }
+    }
+
+    free(cmd_size);
+
+    return cmd_pos[program->size];
+}
+
+/**
+*   @brief Translates the array of instructions back to "machine code", the inverse of "decode_program()".
+*   @brief Jump indices become positions from "cmd_pos". The header is not written.
+*
+*   @param program      [in]  - decoded program
+*   @param version      [in]  - version of "machine code"
+*   @param cmd_pos      [in]  - positions counted by "encode_layout()" for the same version
+*   @param machine_code [out] - buffer of "cmd_pos[program->size]" bytes
+*/
+
+void encode_program(const decoded *const program, const char version, const int *cmd_pos, void *const machine_code)
+{
+    assert(program      != nullptr);
+    assert(cmd_pos      != nullptr);
+    assert(machine_code != nullptr);
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        const instruction *cur  = program->cmds + cmd_cnt;
+        char              *code = (char *) machine_code + cmd_pos[cmd_cnt];
+
+        *code++ = (char) cur->cmd;
+
+        switch (cur->handler)
+        {
+            case CMD_PUSH:
+            case CMD_POP:
+                if (cur->cmd & CMD_REG_ARG) *code++ = (char) cur->reg;
+                if (cur->handler == CMD_POP && !(cur->cmd & CMD_MEM_ARG)) break;
+                if (cur->cmd & CMD_NUM_ARG) encode_val(code, cur->val, version);
+                break;
+
+            case CMD_JMP: case CMD_JA: case CMD_JAE: case CMD_JB:
+            case CMD_JBE: case CMD_JE: case CMD_JNE: case CMD_CALL:
+                if (version >= 3) write_varint(code, zigzag_encode((stack_el) (cmd_pos[cur->jmp] - cmd_pos[cmd_cnt])),
+                                               cmd_pos[cmd_cnt + 1] - cmd_pos[cmd_cnt] - 1);
+                else              memcpy(code, cmd_pos + cur->jmp, sizeof(int));
+                break;
+
+            case CMD_PUSH_MANY:
+            case CMD_POP_MANY:
+            case CMD_BLIT:
+                if (version >= 3)
+                {
+                    write_varint(code, cur->val, varint_size(cur->val));
+                    code += varint_size(cur->val);
+
+                    for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt) code = encode_val(code, cur->data[val_cnt], version);
+                    break;
+                }
+                memcpy(code, &cur->val, sizeof(long));
+                memcpy(code + sizeof(long), cur->data, cur->val * sizeof(stack_el));
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/**
+*   @brief Counts size (in bytes) of the instruction in "machine code".
+*/
+
+static int encode_size(const instruction *cur, const char version)
+{
+    assert(cur != nullptr);
+
+    int size = 1;
+
+    switch (cur->handler)
+    {
+        case CMD_PUSH:
+        case CMD_POP:
+            if (cur->cmd & CMD_REG_ARG) size += 1;
+            if (cur->handler == CMD_POP && !(cur->cmd & CMD_MEM_ARG)) break;
+            if (cur->cmd & CMD_NUM_ARG) size += (version >= 3) ? varint_size(zigzag_encode(cur->val)) : (int) sizeof(stack_el);
+            break;
+
+        case CMD_JMP: case CMD_JA: case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE: case CMD_JNE: case CMD_CALL:
+            size += (version >= 3) ? 1 : (int) sizeof(int); // the offset of v3 grows in "encode_layout()"
+            break;
+
+        case CMD_PUSH_MANY:
+        case CMD_POP_MANY:
+        case CMD_BLIT:
+            if (version >= 3)
+            {
+                size += varint_size(cur->val);
+                for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt) size += varint_size(zigzag_encode(cur->data[val_cnt]));
+                break;
+            }
+            size += (int) (sizeof(long) + cur->val * sizeof(stack_el));
+            break;
+
+        default:
+            break;
+    }
+
+    return size;
+}
+
+/**
+*   @brief Writes the number argument: 8 bytes for v1 and v2 and zigzag varint for v3.
+*
+*   @return position after the argument
+*/
+
+static char *encode_val(char *code, const stack_el val, const char version)
+{
+    assert(code != nullptr);
+
+    if (version < 3)
+    {
+        memcpy(code, &val, sizeof(stack_el));
+        return code + sizeof(stack_el);
+    }
+
+    stack_el zigzag = zigzag_encode(val);
+    int      len    = varint_size(zigzag);
+
+    write_varint(code, zigzag, len);
+    return code + len;
+}
+
+/**
+*   @brief Reads varint.
+*
+*   @return true if the varint is inside "machine code" and false else
+*/
+
+static bool read_varint(const char *code, const size_t size, size_t *const pos, stack_el *const val)
+{
+    stack_el res = 0;
+
+    for (int byte_cnt = 0; byte_cnt < VARINT_MAX; ++byte_cnt)
+    {
+        if (*pos >= size) return false;
+        unsigned char byte = (unsigned char) code[(*pos)++];
+
+        if (byte_cnt == VARINT_MAX - 1)
+        {
+            res |= (stack_el) byte << (7 * byte_cnt);
+            break;
+        }
+
+        res |= (stack_el) (byte & 0x7F) << (7 * byte_cnt);
+        if (!(byte & 0x80)) break;
+    }
+
+    *val = res;
+    return true;
+}
+
+/**
+*   @brief Writes varint of exactly "len" bytes, the value is padded by zero groups if it needs less.
+*
+*   @param len [in] - bytes to write, not less than "varint_size(val)"
+*/
+
+static void write_varint(char *code, stack_el val, const int len)
+{
+    assert(code != nullptr);
+    assert(len  >= varint_size(val) && len <= VARINT_MAX);
+
+    for (int byte_cnt = 0; byte_cnt < len - 1; ++byte_cnt)
+    {
+        code[byte_cnt] = (char) ((val & 0x7F) | 0x80);
+        val >>= 7;
+    }
+    code[len - 1] = (char) val;
+}
+
+/**
+*   @brief Counts bytes of the shortest varint of "val".
+*/
+
+static int varint_size(const stack_el val)
+{
+    int size = 1;
+    while (size < VARINT_MAX && (val >> (7 * size)) != 0) ++size;
+
+    return size;
+}
+
+/**
+*   @brief Maps signed values to unsigned ones so that values close to zero are small: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+*/
+
+static stack_el zigzag_encode(const stack_el val)
+{
+    return (val << 1) ^ (0 - (val >> 63));
+}
+
+static stack_el zigzag_decode(const stack_el val)
+{
+    return (val >> 1) ^ (0 - (val & 1));
+}
@@ -0,0 +1,50 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include "machine.h"
+
+struct instruction
+{
+    unsigned char handler;  // command without argument bits (cmd & mask01)
+    unsigned char cmd;      // command with    argument bits
+    unsigned char reg;      // register slot, 0 if there is no register argument
+
+    int jmp;                // index of the instruction to jump to
+
+    stack_el        val;    // number argument, number of values for PUSH_MANY, POP_MANY and BLIT
+    const stack_el *data;   // values of PUSH_MANY, POP_MANY and BLIT
+};
+
+/*
+ * Values of BLIT are spans of RAM cells: for every span - the number of cells skipped after the previous span
+ * (from the cell 0 for the first one), the number of runs and for every run - its length and its color.
+ * BLIT writes the colors of the runs one after another from the beginning of the span.
+ */
+
+struct decoded
+{
+    instruction *cmds;
+    int          size;      // number of instructions without the final one
+
+    stack_el    *values;    // values of PUSH_MANY, POP_MANY and BLIT unpacked from GD v3, "data" points here, nullptr for v1 and v2
+};
+
+/*
+ * GD v3 differs from v2 only in the arguments, the command and the register bytes are the same:
+ * - number argument                        - zigzag varint;
+ * - jump argument                          - zigzag varint of the offset from the position of the jump command to its target;
+ * - PUSH_MANY, POP_MANY and BLIT arguments - varint of the number of values, then every value as zigzag varint.
+ * Varint is 7 bits per byte from the low ones, the high bit is set if the next byte follows,
+ * the 9th byte keeps the last 8 bits, so a 64-bit value takes 1 to 9 bytes.
+ */
+
+const char GD_VERSION_MAX = 3;
+
+bool decode_program (const void *machine_code, const size_t machine_size, const char version, decoded *const program);
+bool decode_block   (const void *block, const size_t block_size, const int block_pos, const char version, decoded *const program, int **cmd_pos);
+void decode_dtor    (decoded *const program);
+
+int  encode_layout  (const decoded *const program, const char version, const int start, int *const cmd_pos);
+void encode_program (const decoded *const program, const char version, const int *cmd_pos, void *const machine_code);
+
+#endif //DECODE_H
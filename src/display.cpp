@@ -0,0 +1,423 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifndef CPU_HEADLESS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <SFML/Graphics.hpp>
+#endif
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+#include "cpu.h"
+#include "convert.h"
+#include "display.h"
+
+#ifndef CPU_HEADLESS
+
+const int FRAME_BUF_NUM = 3;
+const int POLL_PERIOD   = 10; // milliseconds between handling events when there are no new frames
+
+/*
+ * Triple buffering: the interpreter converts RAM into "frames[back]" and swaps it with "frames[ready]".
+ * The presenter thread swaps "frames[ready]" with "frames[front]" and shows "frames[front]".
+ * If a new frame is published before the previous one is taken by the presenter, the previous one is dropped.
+ *
+ * Only changed rows are converted and uploaded:
+ * "stale[i]"   - rows of "frames[i]" which are older than RAM,
+ * "changed[i]" - rows of "frames[i]" which are changed since the frame shown by the texture.
+ */
+
+struct presenter
+{
+    std::thread             thread;
+    std::mutex              mutex;
+    std::condition_variable new_frame;
+
+    unsigned      *frames [FRAME_BUF_NUM];
+    unsigned char *stale  [FRAME_BUF_NUM];
+    unsigned char *changed[FRAME_BUF_NUM];
+    int back;
+    int ready;
+    int front;
+
+    bool has_new;   // "frames[ready]" is not shown yet
+    bool is_stop;
+
+    std::atomic<bool>               is_open;
+    std::atomic<unsigned long long> presented;
+    std::atomic<unsigned long long> uploaded;
+};
+
+static void presenter_run (display *const scr);
+
+#endif
+
+static void mark_rows   (display *const scr, unsigned char *dirty);
+static void convert_row (unsigned *frame, const stack_el *ram, const unsigned width, const unsigned row);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Opens the window and starts the presenter thread or, in headless mode, opens the raw framebuffer file.
+*
+*   @param scr         [out] - pointer to the "display" to open
+*   @param width       [in]  - width  of the frame
+*   @param height      [in]  - height of the frame
+*   @param is_headless [in]  - true to work without window
+*   @param frames_file [in]  - name of the raw framebuffer file for headless mode, nullptr to drop frames
+*
+*   @return true if the display is opened and false else
+*
+*   @note the program built with CPU_HEADLESS has no window and works only in headless mode
+*/
+
+bool display_ctor(display *const scr, const unsigned width, const unsigned height, const bool is_headless, const char *frames_file)
+{
+    assert(scr != nullptr);
+
+    *scr = {};
+    scr->width       = width;
+    scr->height      = height;
+    scr->is_headless = is_headless;
+
+    scr->rows = (unsigned char *) calloc(height, sizeof(unsigned char));
+    assert(scr->rows != nullptr);
+
+#ifdef CPU_HEADLESS
+    scr->is_headless = true;
+#endif
+
+    if (scr->is_headless)
+    {
+        if (frames_file == nullptr) return true;
+
+        scr->frames = fopen(frames_file, "wb");
+        if (scr->frames == nullptr)
+        {
+            fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\" to write frames in\n", frames_file);
+            return false;
+        }
+
+        scr->frame = (unsigned *) calloc(width * height, sizeof(unsigned));
+        assert(scr->frame != nullptr);
+
+        return true;
+    }
+
+#ifndef CPU_HEADLESS
+    presenter *pres = new presenter;
+
+    for (int buf_cnt = 0; buf_cnt < FRAME_BUF_NUM; ++buf_cnt)
+    {
+        pres->frames [buf_cnt] = (unsigned *)      calloc(width * height, sizeof(unsigned));
+        pres->stale  [buf_cnt] = (unsigned char *) calloc(height,         sizeof(unsigned char));
+        pres->changed[buf_cnt] = (unsigned char *) calloc(height,         sizeof(unsigned char));
+        assert(pres->frames [buf_cnt] != nullptr);
+        assert(pres->stale  [buf_cnt] != nullptr);
+        assert(pres->changed[buf_cnt] != nullptr);
+    }
+    pres->back    = 0;
+    pres->ready   = 1;
+    pres->front   = 2;
+    pres->has_new = false;
+    pres->is_stop = false;
+    pres->is_open   = true;
+    pres->presented = 0;
+    pres->uploaded  = 0;
+
+    scr->pres    = pres;
+    pres->thread = std::thread(presenter_run, scr);
+#endif
+
+    return true;
+}
+
+/**
+*   @brief Stops the presenter thread and closes the window. After it counters of frames are final.
+*/
+
+void display_close(display *const scr)
+{
+    assert(scr != nullptr);
+
+#ifndef CPU_HEADLESS
+    presenter *pres = scr->pres;
+    if (pres == nullptr || !pres->thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(pres->mutex);
+        pres->is_stop = true;
+    }
+    pres->new_frame.notify_one();
+    pres->thread.join();
+
+    if (pres->has_new) ++scr->frames_dropped;
+    pres->has_new = false;
+
+    scr->frames_presented = pres->presented;
+    scr->rows_updated     = pres->uploaded;
+#endif
+}
+
+void display_dtor(display *const scr)
+{
+    assert(scr != nullptr);
+
+    display_close(scr);
+
+    if (scr->frames != nullptr) fclose(scr->frames);
+    free(scr->frame);
+    free(scr->rows);
+
+#ifndef CPU_HEADLESS
+    if (scr->pres != nullptr)
+    {
+        for (int buf_cnt = 0; buf_cnt < FRAME_BUF_NUM; ++buf_cnt)
+        {
+            free(scr->pres->frames [buf_cnt]);
+            free(scr->pres->stale  [buf_cnt]);
+            free(scr->pres->changed[buf_cnt]);
+        }
+        delete scr->pres;
+    }
+#endif
+
+    *scr = {};
+}
+
+/**
+*   @brief Checks if the window is opened. Display in headless mode is always opened.
+*/
+
+bool display_is_open(display *const scr)
+{
+    assert(scr != nullptr);
+
+#ifndef CPU_HEADLESS
+    if (scr->pres != nullptr) return scr->pres->is_open;
+#endif
+
+    return true;
+}
+
+/**
+*   @brief Waits until the window is closed. Returns immediately in headless mode.
+*/
+
+void display_wait(display *const scr)
+{
+    assert(scr != nullptr);
+
+#ifndef CPU_HEADLESS
+    while (scr->pres != nullptr && scr->pres->is_open) std::this_thread::sleep_for(std::chrono::milliseconds(POLL_PERIOD));
+#endif
+}
+
+/**
+*   @brief Publishes RAM as the frame: every cell is one RGBA-pixel. Doesn't wait for the frame to be shown.
+*   @brief In headless mode appends the frame to the raw framebuffer file or drops it.
+*   @brief Only rows containing dirty chunks of RAM are converted.
+*
+*   @param scr   [in]      - display to show the frame on
+*   @param ram   [in]      - RAM of the CPU, "scr->width * scr->height" cells
+*   @param dirty [in][out] - dirty[i] != 0 if the chunk i of RAM is changed since the last frame, it is cleared
+*/
+
+void display_draw(display *const scr, const stack_el *ram, unsigned char *dirty)
+{
+    assert(scr   != nullptr);
+    assert(ram   != nullptr);
+    assert(dirty != nullptr);
+
+    ++scr->frames_produced;
+
+    mark_rows(scr, dirty);
+
+    if (scr->is_headless)
+    {
+        if (scr->frames == nullptr)
+        {
+            ++scr->frames_dropped;
+            return;
+        }
+
+        for (unsigned row = 0; row < scr->height; ++row)
+        {
+            if (!scr->rows[row]) continue;
+
+            convert_row(scr->frame, ram, scr->width, row);
+            ++scr->rows_updated;
+        }
+
+        fwrite(scr->frame, sizeof(unsigned), scr->width * scr->height, scr->frames);
+        ++scr->frames_presented;
+        return;
+    }
+
+#ifndef CPU_HEADLESS
+    presenter *pres = scr->pres;
+
+    int            back    = pres->back;
+    unsigned char *stale   = pres->stale[back];
+
+    for (unsigned row = 0; row < scr->height; ++row)
+    {
+        if (scr->rows[row])
+        {
+            for (int buf_cnt = 0; buf_cnt < FRAME_BUF_NUM; ++buf_cnt) pres->stale[buf_cnt][row] = 1;
+        }
+        if (!stale[row]) continue;
+
+        convert_row(pres->frames[back], ram, scr->width, row);
+        stale[row] = 0;
+    }
+    memcpy(pres->changed[back], scr->rows, scr->height);
+
+    {
+        std::lock_guard<std::mutex> lock(pres->mutex);
+
+        pres->back  = pres->ready;
+        pres->ready = back;
+
+        if (pres->has_new)
+        {
+            // the dropped frame is not shown, so its changes are shown with the new one
+            ++scr->frames_dropped;
+            for (unsigned row = 0; row < scr->height; ++row) pres->changed[back][row] |= pres->changed[pres->back][row];
+        }
+        pres->has_new = true;
+    }
+    pres->new_frame.notify_one();
+#endif
+}
+
+/**
+*   @brief Marks rows of the frame containing dirty chunks of RAM in "scr->rows" and clears "dirty".
+*/
+
+static void mark_rows(display *const scr, unsigned char *dirty)
+{
+    assert(scr   != nullptr);
+    assert(dirty != nullptr);
+
+    unsigned pixel_num = scr->width * scr->height;
+
+    memset(scr->rows, 0, scr->height);
+
+    for (unsigned chunk = 0; (chunk << DIRTY_SHIFT) < pixel_num; ++chunk)
+    {
+        if (!dirty[chunk]) continue;
+        dirty[chunk] = 0;
+
+        unsigned first = chunk << DIRTY_SHIFT;
+        unsigned last  = ((chunk + 1) << DIRTY_SHIFT) - 1;
+        if (last >= pixel_num) last = pixel_num - 1;
+
+        memset(scr->rows + first / scr->width, 1, last / scr->width - first / scr->width + 1);
+    }
+}
+
+/**
+*   @brief Converts the row of RAM to RGBA-pixels of "frame".
+*/
+
+static void convert_row(unsigned *frame, const stack_el *ram, const unsigned width, const unsigned row)
+{
+    assert(frame != nullptr);
+    assert(ram   != nullptr);
+
+    unsigned       *dst = frame + row * width;
+    const stack_el *src = ram   + row * width;
+
+    convert_cells(dst, src, width);
+}
+
+#ifndef CPU_HEADLESS
+
+/**
+*   @brief Presenter thread: owns the window, shows the newest published frame and handles events of the window.
+*
+*   @param scr [in] - display to show frames of
+*/
+
+static void presenter_run(display *const scr)
+{
+    assert(scr != nullptr);
+
+    presenter *pres = scr->pres;
+
+    sf::RenderWindow wnd(sf::VideoMode(scr->width, scr->height), "RAM");
+    wnd.setFramerateLimit(60);
+
+    sf::Texture tx;
+    tx.create(scr->width, scr->height);
+
+    sf::Sprite sprite(tx);
+    sprite.setPosition(0, 0);
+
+    while (pres->is_open)
+    {
+        bool is_new = false;
+        {
+            std::unique_lock<std::mutex> lock(pres->mutex);
+            pres->new_frame.wait_for(lock, std::chrono::milliseconds(POLL_PERIOD), [pres]{ return pres->has_new || pres->is_stop; });
+
+            if (pres->is_stop) break;
+
+            if ((is_new = pres->has_new))
+            {
+                int tmp       = pres->front;
+                pres->front   = pres->ready;
+                pres->ready   = tmp;
+                pres->has_new = false;
+            }
+        }
+
+        sf::Event event;
+        while (wnd.pollEvent(event))
+        {
+            if (event.type == sf::Event::Closed) pres->is_open = false;
+        }
+        if (!pres->is_open) break;
+
+        if (is_new)
+        {
+            unsigned      *frame   = pres->frames [pres->front];
+            unsigned char *changed = pres->changed[pres->front];
+
+            for (unsigned row = 0; row < scr->height; )
+            {
+                if (!changed[row])
+                {
+                    ++row;
+                    continue;
+                }
+
+                unsigned first = row;
+                while (row < scr->height && changed[row]) changed[row++] = 0;
+
+                tx.update((sf::Uint8 *) (frame + first * scr->width), scr->width, row - first, 0, first);
+                pres->uploaded += row - first;
+            }
+
+            wnd.draw(sprite);
+            wnd.display();
+
+            ++pres->presented;
+        }
+    }
+
+    wnd.close();
+    pres->is_open = false;
+}
+
+#endif
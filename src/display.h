@@ -0,0 +1,36 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdio.h>
+
+#include "machine.h"
+
+struct presenter;
+
+struct display
+{
+    bool is_headless;
+
+    presenter *pres;                // thread showing frames in the window, nullptr in headless mode
+    FILE      *frames;              // raw framebuffer file in headless mode, nullptr - frames are dropped
+    unsigned  *frame;               // frame for the raw framebuffer file
+
+    unsigned char *rows;            // rows[i] != 0 if the row i is changed since the last "DRAW"
+
+    unsigned long long frames_produced;
+    unsigned long long frames_presented;
+    unsigned long long frames_dropped;
+    unsigned long long rows_updated;    // rows converted for the raw framebuffer file or uploaded to the window
+
+    unsigned width;
+    unsigned height;
+};
+
+bool display_ctor    (display *const scr, const unsigned width, const unsigned height, const bool is_headless, const char *frames_file);
+void display_close   (display *const scr);
+void display_dtor    (display *const scr);
+bool display_is_open (display *const scr);
+void display_wait    (display *const scr);
+void display_draw    (display *const scr, const stack_el *ram, unsigned char *dirty);
+
+#endif //DISPLAY_H
@@ -0,0 +1,512 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+#include "read_write.h"
+#include "lz.h"
+#include "gdz.h"
+
+const int GDZ_SLOT_NUM = GDZ_WINDOW + GDZ_KEPT;
+
+/*
+ * Slot of the window. The loader thread changes only the slots whose blocks are out of the window,
+ * so the executed block is read without the mutex.
+ */
+
+struct gdz_slot
+{
+    int  block;                 // -1 if the slot is empty
+    bool is_ready;              // the block is decoded
+    bool is_ok;                 // the block is decompressed and decoded without errors
+    long last_use;              // number of the last "gdz_seek()" which moved to this block
+
+    char    *raw;               // decompressed block, "data" of PUSH_MANY, POP_MANY and BLIT of v1 and v2 point here
+    gdz_code code;
+};
+
+struct gdz_loader
+{
+    std::thread             thread;
+    std::mutex              mutex;
+    std::condition_variable changed;
+
+    gdz_slot slots[GDZ_SLOT_NUM];
+    bool    *is_loaded;         // is_loaded[i] is true if the block i was decompressed once
+    int      want;              // block executed now, the window is "want", "want + 1", ...
+    long     move_num;          // "gdz_seek()" which moved to another block
+    bool     is_stop;
+};
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static void loader_run  (gdz_stream *const stream);
+static int  next_block  (const gdz_stream *const stream);
+static bool load_block  (gdz_stream *const stream, const int block, gdz_slot *const slot);
+static void free_slot   (gdz_slot *const slot);
+static int  find_block  (const gdz_stream *const stream, const int pos);
+static int  find_cmd    (const int *cmd_pos, const int cmd_num, const int pos);
+static bool gdz_error   (gdz_stream *const stream, const char *file_name, const char *reason);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Packs the machine code in the container: cuts it in blocks of whole commands and compresses every block.
+*   @brief A block which is not smaller after compression is stored as it is.
+*
+*   @param machine_code   [in]  - machine code with the header
+*   @param machine_size   [in]  - size (in bytes) of the machine code with the header
+*   @param version        [in]  - version of the machine code
+*   @param container      [out] - the container, it must be freed
+*   @param container_size [out] - size (in bytes) of the container
+*
+*   @return true if the machine code is packed and false if it can't be decoded
+*/
+
+bool gdz_pack(const void *machine_code, const size_t machine_size, const char version, void **container, size_t *const container_size)
+{
+    assert(machine_code   != nullptr);
+    assert(container      != nullptr);
+    assert(container_size != nullptr);
+
+    if (machine_size < sizeof(header)) return false;
+
+    const char *code    = (const char *) machine_code;
+    decoded     program = {};
+    int        *cmd_pos = nullptr;
+
+    if (!decode_block(code + sizeof(header), machine_size - sizeof(header), sizeof(header), version, &program, &cmd_pos)) return false;
+
+    int block_num = 1;
+    for (int cmd_cnt = 0, block_pos = 0; cmd_cnt < program.size; ++cmd_cnt)
+    {
+        if ((size_t) (cmd_pos[cmd_cnt] - block_pos) < GDZ_BLOCK_SIZE) continue;
+
+        block_pos = cmd_pos[cmd_cnt];
+        ++block_num;
+    }
+
+    gdz_block *blocks = (gdz_block *) calloc(block_num, sizeof(gdz_block));
+    assert(blocks != nullptr);
+
+    for (int cmd_cnt = 0, block_cnt = 0; cmd_cnt < program.size; ++cmd_cnt)
+    {
+        if ((size_t) cmd_pos[cmd_cnt] - blocks[block_cnt].raw_pos < GDZ_BLOCK_SIZE) continue;
+
+        blocks[++block_cnt].raw_pos = (size_t) cmd_pos[cmd_cnt];
+    }
+
+    size_t capacity = sizeof(gdz_header) + block_num * sizeof(gdz_block);
+    for (int block_cnt = 0; block_cnt < block_num; ++block_cnt)
+    {
+        size_t raw_end = (block_cnt + 1 < block_num) ? blocks[block_cnt + 1].raw_pos : machine_size;
+
+        blocks[block_cnt].raw_size = (int) (raw_end - blocks[block_cnt].raw_pos);
+        capacity += lz_bound((size_t) blocks[block_cnt].raw_size);
+    }
+
+    char  *out      = (char *) calloc(capacity, sizeof(char));
+    size_t comp_pos = sizeof(gdz_header) + block_num * sizeof(gdz_block);
+    assert(out != nullptr);
+
+    for (int block_cnt = 0; block_cnt < block_num; ++block_cnt)
+    {
+        gdz_block  *cur = blocks + block_cnt;
+        const char *raw = code + cur->raw_pos;
+
+        size_t comp_size = lz_compress(raw, (size_t) cur->raw_size, out + comp_pos);
+        if (comp_size >= (size_t) cur->raw_size)
+        {
+            memcpy(out + comp_pos, raw, (size_t) cur->raw_size);
+            comp_size = (size_t) cur->raw_size;
+        }
+
+        cur->comp_pos  = comp_pos;
+        cur->comp_size = (int) comp_size;
+        comp_pos      += comp_size;
+    }
+
+    gdz_header head = {'G', 'Z', GDZ_VERSION, block_num, machine_size};
+    memcpy(out, &head, sizeof(gdz_header));
+    memcpy(out + sizeof(gdz_header), blocks, block_num * sizeof(gdz_block));
+
+    *container      = out;
+    *container_size = comp_pos;
+
+    free(blocks);
+    free(cmd_pos);
+    decode_dtor(&program);
+
+    return true;
+}
+
+/**
+*   @brief Checks if the file begins with the signature of the container.
+*/
+
+bool gdz_is_container(const char *file_name)
+{
+    assert(file_name != nullptr);
+
+    FILE *stream = fopen(file_name, "rb");
+    if (stream == nullptr) return false;
+
+    char signature[2] = {};
+    bool is_container = fread(signature, sizeof(char), 2, stream) == 2 && signature[0] == 'G' && signature[1] == 'Z';
+
+    fclose(stream);
+    return is_container;
+}
+
+/**
+*   @brief Maps the container, checks its block index and reads the header of the machine code from the first block.
+*   @brief Blocks are loaded by the thread started by the first "gdz_seek()".
+*
+*   @param stream    [out] - pointer to the "gdz_stream" to open
+*   @param file_name [in]  - name of the container
+*
+*   @return true if the container is opened and false else
+*/
+
+bool gdz_open(gdz_stream *const stream, const char *file_name)
+{
+    assert(stream    != nullptr);
+    assert(file_name != nullptr);
+
+    *stream = {};
+    stream->cur_slot = -1;
+
+    stream->file = (const char *) map_file(file_name, &stream->file_size);
+    if (stream->file == nullptr) return gdz_error(stream, file_name, "can't be opened");
+
+    gdz_header head = {};
+    if (stream->file_size < sizeof(gdz_header)) return gdz_error(stream, file_name, "is too small");
+    memcpy(&head, stream->file, sizeof(gdz_header));
+
+    if (head.fst_let != 'G' || head.sec_let != 'Z' || head.version != GDZ_VERSION) return gdz_error(stream, file_name, "has wrong signature");
+    if (head.block_num <= 0 || (size_t) head.block_num > (stream->file_size - sizeof(gdz_header)) / sizeof(gdz_block))
+        return gdz_error(stream, file_name, "has wrong block index");
+
+    stream->blocks    = (const gdz_block *) (stream->file + sizeof(gdz_header));
+    stream->block_num = head.block_num;
+
+    for (int block_cnt = 0; block_cnt < stream->block_num; ++block_cnt)
+    {
+        const gdz_block *cur = stream->blocks + block_cnt;
+
+        if (cur->raw_pos != stream->raw_size || cur->raw_size <= 0 || cur->comp_size <= 0 ||
+            cur->comp_pos > stream->file_size || (size_t) cur->comp_size > stream->file_size - cur->comp_pos)
+            return gdz_error(stream, file_name, "has wrong block index");
+
+        stream->raw_size += (size_t) cur->raw_size;
+    }
+    if (stream->raw_size != head.raw_size || (size_t) stream->blocks[0].raw_size < sizeof(header))
+        return gdz_error(stream, file_name, "has wrong block index");
+
+    gdz_slot first = {};
+    if (!load_block(stream, -1, &first))
+    {
+        free_slot(&first);
+        return gdz_error(stream, file_name, "has damaged first block");
+    }
+
+    memcpy(&stream->machine_info, first.raw, sizeof(header));
+    free_slot(&first);
+
+    return true;
+}
+
+/**
+*   @brief Finds the command at the position "pos" of the machine code. Waits for the loader thread if its block is not decoded yet.
+*   @brief The window moves to this block, so the loader thread decodes the next blocks.
+*
+*   @param stream [in][out] - opened container
+*   @param pos    [in]      - position of the command in the machine code
+*   @param pc     [out]     - index of the command in the returned block
+*
+*   @return the block which is valid until the next "gdz_seek()" and nullptr if there is no command at "pos"
+*/
+
+const gdz_code *gdz_seek(gdz_stream *const stream, const int pos, int *const pc)
+{
+    assert(stream != nullptr);
+    assert(pc     != nullptr);
+
+    int block = find_block(stream, pos);
+    if (block == -1) return nullptr;
+
+    gdz_loader *loader = stream->loader;
+    if (loader == nullptr)
+    {
+        loader = stream->loader = new gdz_loader;
+
+        for (int slot_cnt = 0; slot_cnt < GDZ_SLOT_NUM; ++slot_cnt) loader->slots[slot_cnt] = {-1, false, false, 0, nullptr, {}};
+
+        loader->is_loaded = (bool *) calloc(stream->block_num, sizeof(bool));
+        loader->want      = block;
+        loader->move_num  = 0;
+        loader->is_stop   = false;
+        assert(loader->is_loaded != nullptr);
+
+        loader->thread = std::thread(loader_run, stream);
+    }
+
+    if (stream->cur_slot == -1 || loader->slots[stream->cur_slot].block != block)
+    {
+        std::unique_lock<std::mutex> lock(loader->mutex);
+
+        loader->want = block;
+        loader->changed.notify_all();
+
+        loader->changed.wait(lock, [loader, block, stream]
+        {
+            for (int slot_cnt = 0; slot_cnt < GDZ_SLOT_NUM; ++slot_cnt)
+            {
+                if (loader->slots[slot_cnt].block != block || !loader->slots[slot_cnt].is_ready) continue;
+
+                stream->cur_slot = slot_cnt;
+                loader->slots[slot_cnt].last_use = ++loader->move_num;
+                return true;
+            }
+            return false;
+        });
+    }
+
+    const gdz_slot *slot = loader->slots + stream->cur_slot;
+    if (!slot->is_ok) return nullptr;
+
+    *pc = find_cmd(slot->code.cmd_pos, slot->code.program.size, pos);
+    if (*pc == -1) return nullptr;
+
+    return &slot->code;
+}
+
+/**
+*   @brief Stops the loader thread, frees the window and unmaps the container. Counters of loaded blocks are kept.
+*/
+
+void gdz_close(gdz_stream *const stream)
+{
+    assert(stream != nullptr);
+
+    gdz_loader *loader = stream->loader;
+    if (loader != nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(loader->mutex);
+            loader->is_stop = true;
+        }
+        loader->changed.notify_all();
+        loader->thread.join();
+
+        for (int slot_cnt = 0; slot_cnt < GDZ_SLOT_NUM; ++slot_cnt) free_slot(loader->slots + slot_cnt);
+
+        free(loader->is_loaded);
+        delete loader;
+    }
+
+    unmap_file(stream->file, stream->file_size);
+
+    stream->file     = nullptr;
+    stream->blocks   = nullptr;
+    stream->loader   = nullptr;
+    stream->cur_slot = -1;
+}
+
+/**
+*   @brief Loader thread: decompresses and decodes the blocks of the window one by one in order of execution.
+*   @brief The slot of the block which is out of the window is reused for the new one.
+*/
+
+static void loader_run(gdz_stream *const stream)
+{
+    assert(stream != nullptr);
+
+    gdz_loader *loader = stream->loader;
+
+    while (true)
+    {
+        int       block = -1;
+        gdz_slot *slot  = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(loader->mutex);
+            loader->changed.wait(lock, [loader, stream, &block]{ return loader->is_stop || (block = next_block(stream)) != -1; });
+
+            if (loader->is_stop) break;
+
+            for (int slot_cnt = 0; slot_cnt < GDZ_SLOT_NUM; ++slot_cnt)
+            {
+                gdz_slot *cur = loader->slots + slot_cnt;
+                if (cur->block != -1 && cur->block >= loader->want && cur->block < loader->want + GDZ_WINDOW) continue;
+
+                if (slot == nullptr || cur->last_use < slot->last_use) slot = cur;  // "last_use" of empty slots is 0
+            }
+            assert(slot != nullptr);
+
+            slot->block    = block;
+            slot->is_ready = false;
+            slot->last_use = 0;     // the prefetched block is replaced first if it isn't executed
+        }
+
+        bool is_ok = load_block(stream, block, slot);
+        {
+            std::lock_guard<std::mutex> lock(loader->mutex);
+
+            slot->is_ready = true;
+            slot->is_ok    = is_ok;
+
+            ++stream->load_num;
+            if (loader->is_loaded[block]) ++stream->reload_num;
+            loader->is_loaded[block] = true;
+        }
+        loader->changed.notify_all();
+    }
+}
+
+/**
+*   @brief Finds the first block of the window which is not in the slots. It is called under the mutex of the loader.
+*
+*   @return the block and -1 if the whole window is in the slots
+*/
+
+static int next_block(const gdz_stream *const stream)
+{
+    const gdz_loader *loader = stream->loader;
+
+    for (int block = loader->want; block < loader->want + GDZ_WINDOW && block < stream->block_num; ++block)
+    {
+        bool is_found = false;
+        for (int slot_cnt = 0; slot_cnt < GDZ_SLOT_NUM && !is_found; ++slot_cnt) is_found = (loader->slots[slot_cnt].block == block);
+
+        if (!is_found) return block;
+    }
+
+    return -1;
+}
+
+/**
+*   @brief Decompresses the block in the slot and decodes its commands. The old block of the slot is freed.
+*   @brief Pages of the compressed block are dropped from memory, they are read from the file again if the block is reloaded.
+*
+*   @param block [in] - index of the block, -1 to decompress the first block without decoding
+*
+*   @return true if the block is correct and false else
+*/
+
+static bool load_block(gdz_stream *const stream, const int block, gdz_slot *const slot)
+{
+    assert(stream != nullptr);
+    assert(slot   != nullptr);
+
+    free_slot(slot);
+
+    const gdz_block *cur = stream->blocks + (block == -1 ? 0 : block);
+
+    slot->raw = (char *) calloc((size_t) cur->raw_size, sizeof(char));
+    assert(slot->raw != nullptr);
+
+    if (cur->comp_size == cur->raw_size) memcpy(slot->raw, stream->file + cur->comp_pos, (size_t) cur->raw_size);
+    else if (!lz_decompress(stream->file + cur->comp_pos, (size_t) cur->comp_size, slot->raw, (size_t) cur->raw_size))
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "./CPU: can't decompress the block %d\n", block);
+        return false;
+    }
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t page_pos  = cur->comp_pos - cur->comp_pos % page_size;
+    drop_file_pages(stream->file + page_pos, cur->comp_pos + (size_t) cur->comp_size - page_pos);
+
+    if (block == -1) return true;
+
+    size_t skip = (block == 0) ? sizeof(header) : 0;    // the header of the machine code is not a command
+
+    if (!decode_block(slot->raw + skip, (size_t) cur->raw_size - skip, (int) (cur->raw_pos + skip), stream->machine_info.version,
+                      &slot->code.program, &slot->code.cmd_pos))
+    {
+        slot->code = {};
+        return false;
+    }
+
+    return true;
+}
+
+static void free_slot(gdz_slot *const slot)
+{
+    assert(slot != nullptr);
+
+    free(slot->raw);
+    free(slot->code.cmd_pos);
+    decode_dtor(&slot->code.program);
+
+    slot->raw  = nullptr;
+    slot->code = {};
+}
+
+/**
+*   @brief Finds the block with the position "pos" of the machine code using binary search.
+*
+*   @return index of the block and -1 if "pos" is out of the machine code
+*/
+
+static int find_block(const gdz_stream *const stream, const int pos)
+{
+    if (pos < 0 || (size_t) pos >= stream->raw_size) return -1;
+
+    int left  = 0;
+    int right = stream->block_num - 1;
+
+    while (left < right)
+    {
+        int mid = (left + right + 1) / 2;
+
+        if (stream->blocks[mid].raw_pos <= (size_t) pos) left  = mid;
+        else                                             right = mid - 1;
+    }
+
+    return left;
+}
+
+/**
+*   @brief Finds the index of the command by its position using binary search.
+*
+*   @return index of the command and -1 if there is no command at "pos"
+*/
+
+static int find_cmd(const int *cmd_pos, const int cmd_num, const int pos)
+{
+    int left  = 0;
+    int right = cmd_num;
+
+    while (left < right)
+    {
+        int mid = (left + right) / 2;
+
+        if (cmd_pos[mid] < pos) left  = mid + 1;
+        else                    right = mid;
+    }
+
+    if (left < cmd_num && cmd_pos[left] == pos) return left;
+    return -1;
+}
+
+/**
+*   @brief Prints the error of "gdz_open()" and unmaps the container.
+*/
+
+static bool gdz_error(gdz_stream *const stream, const char *file_name, const char *reason)
+{
+    if (stream->file != nullptr) unmap_file(stream->file, stream->file_size);
+    stream->file = nullptr;
+
+    fprintf(stderr, RED "ERROR: " CANCEL "./CPU: the container \"%s\" %s\n", file_name, reason);
+    return false;
+}
@@ -0,0 +1,79 @@
+#ifndef GDZ_H
+#define GDZ_H
+
+#include <stddef.h>
+
+#include "decode.h"
+
+/*
+ * Container of GD machine code compressed by blocks ("lz.h"): gdz_header, "block_num" gdz_block, compressed blocks.
+ * Every block consists of whole commands, the first one begins with the header of the machine code.
+ * A block is decoded by itself ("decode_block()"), jumps to other blocks are resolved while the program is executed.
+ */
+
+struct gdz_header
+{
+    char fst_let;               // 'G'
+    char sec_let;               // 'Z'
+    char version;
+
+    int    block_num;
+    size_t raw_size;            // size of the whole machine code
+};
+
+struct gdz_block
+{
+    size_t raw_pos;             // position of the block in the machine code
+    size_t comp_pos;            // position of the compressed block in the container
+    int    raw_size;
+    int    comp_size;           // "raw_size" if the block is stored without compression
+};
+
+const char   GDZ_VERSION    = 1;
+const size_t GDZ_BLOCK_SIZE = 1 << 18;  // blocks are cut at the first command after this size
+const int    GDZ_WINDOW     = 8;        // blocks decoded ahead: the executed one and the next ones
+const int    GDZ_KEPT       = 8;        // executed blocks kept decoded after they left the window (routines, loops)
+
+/*
+ * Decoded block of the stream.
+ */
+
+struct gdz_code
+{
+    decoded program;            // jumps out of the block lead to CMD_NOT_EXICTING after the final instruction
+    int    *cmd_pos;            // positions of the instructions in the machine code and of the end of the block
+};
+
+struct gdz_loader;
+
+/*
+ * Container executed by blocks. The loader thread decompresses and decodes the blocks from the executed one onwards
+ * into the window of GDZ_WINDOW blocks, so the memory doesn't depend on the size of the program.
+ * GDZ_KEPT blocks which left the window stay decoded, the least recently executed of them is replaced first.
+ * A replaced block is loaded again from the container through the block index.
+ */
+
+struct gdz_stream
+{
+    const char      *file;      // mapped container
+    size_t           file_size;
+    const gdz_block *blocks;
+    int              block_num;
+    size_t           raw_size;
+
+    header machine_info;        // header of the machine code from the first block
+
+    gdz_loader *loader;         // nullptr until the first "gdz_seek()"
+    int         cur_slot;       // slot of the window with the block executed now
+
+    size_t load_num;            // blocks decompressed
+    size_t reload_num;          // blocks decompressed not for the first time
+};
+
+bool            gdz_pack         (const void *machine_code, const size_t machine_size, const char version, void **container, size_t *const container_size);
+bool            gdz_is_container (const char *file_name);
+bool            gdz_open         (gdz_stream *const stream, const char *file_name);
+const gdz_code *gdz_seek         (gdz_stream *const stream, const int pos, int *const pc);
+void            gdz_close        (gdz_stream *const stream);
+
+#endif //GDZ_H
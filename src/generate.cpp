@@ -9,9 +9,23 @@ const int FILE_NAME_LEN   = 100;
 const int WIDTH           = 960;
 const int HEIGHT          = 720;
 const int PIXELS          = 960 * 720;
-
-void draw        (sf::RenderWindow *wnd, const sf::Uint8 *code);
-void get_filename(int img_cnt,           char *const filename);
+const int SPAN_GAP        = 4;          // unchanged pixels between changed ones which are written again instead of a new span
+const int VALS_MAX        = 4 * PIXELS; // values of the longest "blit": a span of one run for every pixel
+const int KEYFRAME_SHARE  = 2;          // see the choice of keyframes below
+
+void   draw            (sf::RenderWindow *wnd, const sf::Uint8 *code);
+void   get_filename    (int img_cnt,           char *const filename);
+size_t encode_keyframe (const unsigned int *frame, unsigned long long *vals);
+size_t encode_delta    (const unsigned int *prev,  const unsigned int *frame, unsigned long long *vals, int *const changed_num);
+size_t encode_runs     (const unsigned int *frame, const int begin, const int end, unsigned long long *vals);
+void   write_blit      (FILE *stream, const unsigned long long *vals, const size_t val_num);
+
+/*
+ * Every frame is one "blit" (see "decode.h") followed by "draw". The frame is written either whole (keyframe)
+ * or by spans of the pixels changed since the previous frame (delta). A keyframe marks the whole RAM as changed,
+ * so the display converts all the rows. It is chosen only if at least 1 / KEYFRAME_SHARE of the pixels has changed
+ * or if it has KEYFRAME_SHARE times fewer values than the delta. RAM is zero before the first frame.
+ */
 
 int main()
 {
@@ -22,76 +36,155 @@ int main()
     assert(stream != nullptr);
 
     char filename[FILE_NAME_LEN] = "";
-    get_filename(1, filename);
-
     sf::Image frame;
-    frame.loadFromFile(filename);
-    const sf::Uint8 *pixels_const = frame.getPixelsPtr();
 
-    sf::Uint8 *pixels_first  = (sf::Uint8 *) calloc(sizeof(int), HEIGHT * WIDTH);
-    sf::Uint8 *pixels_second = (sf::Uint8 *) calloc(sizeof(int), HEIGHT * WIDTH);
+    unsigned int *pixels_first  = (unsigned int *) calloc(PIXELS, sizeof(int));
+    unsigned int *pixels_second = (unsigned int *) calloc(PIXELS, sizeof(int));
 
-    memcpy(pixels_first, pixels_const, 4 * WIDTH * HEIGHT);
+    unsigned long long *key_vals   = (unsigned long long *) calloc(VALS_MAX, sizeof(unsigned long long));
+    unsigned long long *delta_vals = (unsigned long long *) calloc(VALS_MAX, sizeof(unsigned long long));
 
-    fprintf(stream, "push_many %llu\n", WIDTH * HEIGHT);
-    for (unsigned long long ram_cnt = 0; ram_cnt < WIDTH * HEIGHT; ++ram_cnt)
-    {
-        unsigned int color = *(unsigned int *) ((unsigned char *) pixels_first + 4 * ram_cnt);
-        fprintf(stream, "%llu \n", color);
-    }
+    assert(pixels_first  != nullptr);
+    assert(pixels_second != nullptr);
+    assert(key_vals      != nullptr);
+    assert(delta_vals    != nullptr);
 
-    fprintf(stream, "pop_many %llu\n", WIDTH * HEIGHT);
-    for (long long ram_cnt = PIXELS - 1; ram_cnt >= 0; --ram_cnt)   fprintf(stream, "%llu\n", ram_cnt);
-    
-    fprintf(stream, "draw\n");
+    int keyframe_num = 0;
 
-    draw(&wnd, (sf::Uint8 *)pixels_first);
-
-    for (int img_cnt = 2; img_cnt <= NUMBER_OF_FILES; ++img_cnt)
+    for (int img_cnt = 1; img_cnt <= NUMBER_OF_FILES; ++img_cnt)
     {
         get_filename(img_cnt, filename);
         fprintf(stderr, "%s\n", filename);
 
         frame.loadFromFile(filename);
+        memcpy(pixels_second, frame.getPixelsPtr(), 4 * WIDTH * HEIGHT);
 
-        pixels_const = frame.getPixelsPtr();
-        memcpy(pixels_second, pixels_const, 4 * WIDTH * HEIGHT);
+        int    changed_num = 0;
+        size_t key_num     = encode_keyframe(pixels_second, key_vals);
+        size_t delta_num   = encode_delta   (pixels_first, pixels_second, delta_vals, &changed_num);
 
-        unsigned long long changed_number = 0;
-        for (unsigned long long ram_cnt = 0; ram_cnt < WIDTH * HEIGHT; ++ram_cnt)
+        if (changed_num >= PIXELS / KEYFRAME_SHARE || key_num * KEYFRAME_SHARE < delta_num)
         {
-            unsigned int color_first  = *(unsigned int *) ((unsigned char *) pixels_first  + 4 * ram_cnt);
-            unsigned int color_second = *(unsigned int *) ((unsigned char *) pixels_second + 4 * ram_cnt);
-
-            if (color_first != color_second) ++changed_number;
+            write_blit(stream, key_vals, key_num);
+            ++keyframe_num;
         }
+        else write_blit(stream, delta_vals, delta_num);
 
-        fprintf(stream, "push_many %llu\n", changed_number);
-        for (unsigned long long ram_cnt = 0; ram_cnt < WIDTH * HEIGHT; ++ram_cnt)
-        {
-            unsigned int color_first  = *(unsigned int *) ((unsigned char *) pixels_first  + 4 * ram_cnt);
-            unsigned int color_second = *(unsigned int *) ((unsigned char *) pixels_second + 4 * ram_cnt);
+        fprintf(stream, "draw\n");
 
-            if (color_first != color_second) fprintf(stream, "%llu\n", color_second);
-        }
+        draw(&wnd, (sf::Uint8 *) pixels_second);
+
+        memcpy(pixels_first, pixels_second, 4 * WIDTH * HEIGHT);
+    }
+    fprintf(stderr, "%d frames, %d keyframes\n", NUMBER_OF_FILES, keyframe_num);
+
+    fclose(stream);
+
+    free(pixels_first);
+    free(pixels_second);
+    free(key_vals);
+    free(delta_vals);
+
+    return 0;
+}
+
+/**
+*   @brief Encodes the whole frame as one span.
+*
+*   @return number of values
+*/
+
+size_t encode_keyframe(const unsigned int *frame, unsigned long long *vals)
+{
+    assert(frame != nullptr);
+    assert(vals  != nullptr);
+
+    vals[0] = 0;
+
+    return 1 + encode_runs(frame, 0, PIXELS, vals + 1);
+}
+
+/**
+*   @brief Encodes the pixels which differ from "prev" as spans. Spans closer than SPAN_GAP pixels are joined.
+*
+*   @param changed_num [out] - number of the changed pixels
+*
+*   @return number of values
+*/
+
+size_t encode_delta(const unsigned int *prev, const unsigned int *frame, unsigned long long *vals, int *const changed_num)
+{
+    assert(prev        != nullptr);
+    assert(frame       != nullptr);
+    assert(vals        != nullptr);
+    assert(changed_num != nullptr);
 
-        fprintf(stream, "pop_many %llu\n", changed_number);
-        for (long long ram_cnt = PIXELS - 1; ram_cnt >= 0; --ram_cnt)
+    size_t val_num  = 0;
+    int    prev_end = 0;
+
+    *changed_num = 0;
+
+    for (int pos = 0; pos < PIXELS; )
+    {
+        if (prev[pos] == frame[pos])
         {
-            unsigned int color_first  = *(unsigned int *) ((unsigned char *) pixels_first  + 4 * ram_cnt);
-            unsigned int color_second = *(unsigned int *) ((unsigned char *) pixels_second + 4 * ram_cnt);
+            ++pos;
+            continue;
+        }
 
-            if (color_first != color_second) fprintf(stream, "%llu\n", ram_cnt);
+        int end  = pos + 1;     // the first pixel after the last changed one
+        int scan = pos + 1;
+        while (scan < PIXELS && scan - end < SPAN_GAP)
+        {
+            if (prev[scan] != frame[scan]) end = scan + 1;
+            ++scan;
         }
-        fprintf(stream, "draw\n");
-        
-        draw(&wnd, (sf::Uint8 *)pixels_second);
-        
-        memcpy(pixels_first, pixels_second, 4 * WIDTH * HEIGHT);
+        for (int pix_cnt = pos; pix_cnt < end; ++pix_cnt) *changed_num += (prev[pix_cnt] != frame[pix_cnt]);
+
+        vals[val_num++] = (unsigned long long) (pos - prev_end);
+        val_num += encode_runs(frame, pos, end, vals + val_num);
+
+        prev_end = pos = end;
     }
 
-   fclose(stream);
-    return 0;
+    return val_num;
+}
+
+/**
+*   @brief Encodes the pixels from "begin" to "end" as the number of runs and the runs of equal colors.
+*
+*   @return number of values
+*/
+
+size_t encode_runs(const unsigned int *frame, const int begin, const int end, unsigned long long *vals)
+{
+    assert(frame != nullptr);
+    assert(vals  != nullptr);
+
+    size_t val_num = 1;
+
+    for (int pos = begin; pos < end; )
+    {
+        int run_end = pos + 1;
+        while (run_end < end && frame[run_end] == frame[pos]) ++run_end;
+
+        vals[val_num++] = (unsigned long long) (run_end - pos);
+        vals[val_num++] = frame[pos];
+
+        pos = run_end;
+    }
+    vals[0] = (val_num - 1) / 2;
+
+    return val_num;
+}
+
+void write_blit(FILE *stream, const unsigned long long *vals, const size_t val_num)
+{
+    assert(stream != nullptr);
+    assert(vals   != nullptr);
+
+    fprintf(stream, "blit %zu\n", val_num);
+    for (size_t val_cnt = 0; val_cnt < val_num; ++val_cnt) fprintf(stream, "%llu\n", vals[val_cnt]);
 }
 
 void draw(sf::RenderWindow *wnd, const sf::Uint8 *code)
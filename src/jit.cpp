@@ -0,0 +1,1066 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define JIT_SUPPORTED
+#endif
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+#include "jit.h"
+
+/*
+ * Every block of instructions (from a jump target or a command after a jump up to the next jump) is translated to x86-64 code.
+ * Values pushed inside the block are kept in the compile-time "virtual stack": as constants, as guest registers which are not
+ * read yet or as host registers. They are written in "progress->stk" only at the end of the block or when there is no free
+ * host register. Commands working with the window or with stdin/stdout are executed by the interpreter.
+ *
+ * Host registers during execution:
+ *     rbx        - "cpu_store *progress"
+ *     r12        - top of "progress->stk" (the first free element)
+ *     r13        - bottom of "progress->stk"
+ *     r14        - end of the memory reserved for "progress->stk"
+ *     r15        - top of "progress->calls"
+ *     [rsp]      - bottom of "progress->calls"
+ *     [rsp + 8]  - end of the memory reserved for "progress->calls"
+ *     rcx, r8-r11 - values of the virtual stack
+ *     rax, rdx   - scratch registers
+ *     rsi, rdi   - arguments of comparisons and divisions
+ */
+
+enum HOST_REG
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8 , R9 , R10, R11, R12, R13, R14, R15
+};
+
+enum COND
+{
+    COND_B  = 2,
+    COND_AE = 3,
+    COND_E  = 4,
+    COND_NE = 5,
+    COND_BE = 6,
+    COND_A  = 7
+};
+
+const int VS_MAX    = 16;
+const int POOL[]    = {RCX, R8, R9, R10, R11};
+const int POOL_SIZE = sizeof(POOL) / sizeof(POOL[0]);
+const int FRAME     = 24;
+
+enum VS_KIND
+{
+    VS_CONST, // "val" is the value
+    VS_HREG , // the value is in the host register "reg"
+    VS_GREG   // the value is in the guest register "reg"
+};
+
+struct vs_entry
+{
+    VS_KIND  kind;
+    int      reg;
+    stack_el val;
+};
+
+struct jit_fixup
+{
+    size_t pos;     // position of rel32 to patch
+    int    target;  // index of the instruction to jump to
+};
+
+struct jit_compiler
+{
+    unsigned char *buf;
+    size_t         size;
+    size_t         capacity;
+
+    vs_entry vstack[VS_MAX];
+    int      vs_size;
+    bool     reg_used[16];
+
+    jit_fixup *fixups;
+    size_t     fixups_size;
+    size_t     fixups_capacity;
+
+    size_t *block_pos;
+    size_t  epilogue;
+    size_t  err_stub[NEG_VALUE + 1];
+    size_t  bad_entry;
+
+    void **entry;
+};
+
+const int OFF_PC         = offsetof(cpu_store, pc);
+const int OFF_RAM        = offsetof(cpu_store, ram);
+const int OFF_REGS       = offsetof(cpu_store, regs);
+const int OFF_DIRTY      = offsetof(cpu_store, dirty);
+const int OFF_STK_DATA   = offsetof(cpu_store, stk.data);
+const int OFF_STK_SIZE   = offsetof(cpu_store, stk.size);
+const int OFF_STK_CAP    = offsetof(cpu_store, stk.capacity);
+const int OFF_CALLS_DATA = offsetof(cpu_store, calls.data);
+const int OFF_CALLS_SIZE = offsetof(cpu_store, calls.size);
+const int OFF_CALLS_CAP  = offsetof(cpu_store, calls.capacity);
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static void   emit_byte      (jit_compiler *jc, const unsigned char val);
+static void   emit_int       (jit_compiler *jc, const int val);
+static void   emit_long      (jit_compiler *jc, const stack_el val);
+static void   emit_rex       (jit_compiler *jc, const bool wide, const int reg, const int index, const int base);
+static void   emit_opcode    (jit_compiler *jc, const int opcode);
+static void   emit_rr        (jit_compiler *jc, const int opcode, const int reg, const int rm);
+static void   emit_mem       (jit_compiler *jc, const bool wide, const int opcode, const int reg, const int base, const int index, const int disp);
+static void   emit_mov_ri    (jit_compiler *jc, const int dst, const stack_el val);
+static void   emit_alu_ri    (jit_compiler *jc, const int ext, const int dst, const int val);
+static void   emit_shift     (jit_compiler *jc, const int ext, const int dst, const int val);
+static void   emit_add_val   (jit_compiler *jc, const int dst, const stack_el val);
+static size_t emit_jcc       (jit_compiler *jc, const int cond);
+static size_t emit_jmp       (jit_compiler *jc);
+static void   emit_jcc_to    (jit_compiler *jc, const int cond, const size_t target);
+static void   emit_jmp_to    (jit_compiler *jc, const size_t target);
+static void   emit_jmp_block (jit_compiler *jc, const int cond, const int target);
+static void   emit_exit      (jit_compiler *jc, const int pc, const JIT_EXIT exit, const int error);
+static void   patch_rel32    (jit_compiler *jc, const size_t pos, const size_t target);
+
+static int      vs_alloc     (jit_compiler *jc);
+static void     vs_free      (jit_compiler *jc, const vs_entry entry);
+static void     vs_push      (jit_compiler *jc, const vs_entry entry);
+static vs_entry vs_pop       (jit_compiler *jc);
+static void     vs_drop      (jit_compiler *jc);
+static void     vs_store     (jit_compiler *jc, const vs_entry entry, const int base, const int index, const int disp);
+static void     vs_load_to   (jit_compiler *jc, const vs_entry entry, const int dst);
+static int      vs_to_reg    (jit_compiler *jc, const vs_entry entry);
+static void     vs_spill     (jit_compiler *jc);
+static void     vs_flush     (jit_compiler *jc);
+static void     vs_read_greg (jit_compiler *jc, const int slot);
+
+static bool     is_leader_end   (const instruction *cur);
+static void     compile_stubs   (jit_compiler *jc);
+static void     compile_block   (jit_compiler *jc, const decoded *const program, const bool *leader, const int begin);
+static void     compile_cmd     (jit_compiler *jc, const decoded *const program, const int cmd_cnt);
+static void     compile_arith   (jit_compiler *jc, const unsigned char handler);
+static void     compile_cond    (jit_compiler *jc, const instruction *cur);
+static void     compile_ram_idx (jit_compiler *jc, const instruction *cur);
+
+static bool     jit_approx_equal (const stack_el a, const stack_el b);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Translates "program" to x86-64 code.
+*
+*   @param jit     [out] - pointer to the "jit_code" to put the code in
+*   @param program [in]  - decoded program
+*
+*   @return true if the program is translated and false else
+*/
+
+bool jit_compile(jit_code *const jit, const decoded *const program)
+{
+    assert(jit     != nullptr);
+    assert(program != nullptr);
+
+    *jit = {};
+
+#ifndef JIT_SUPPORTED
+    fprintf(stderr, RED "ERROR: " CANCEL "./CPU: JIT supports only x86-64 Linux\n");
+    return false;
+#else
+    jit_compiler jc = {};
+    jc.capacity  = 4096;
+    jc.buf       = (unsigned char *) calloc(jc.capacity, sizeof(char));
+    jc.block_pos = (size_t *)        calloc(program->size + 1, sizeof(size_t));
+    jc.entry     = (void **)         calloc(program->size + 1, sizeof(void *));
+
+    bool *leader = (bool *) calloc(program->size + 1, sizeof(bool));
+
+    assert(jc.buf       != nullptr);
+    assert(jc.block_pos != nullptr);
+    assert(jc.entry     != nullptr);
+    assert(leader       != nullptr);
+
+    leader[0] = true;
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+
+        if (cur->handler == CMD_CALL) leader[cmd_cnt] = true;
+        if (cur->handler == CMD_CALL || cur->handler == CMD_JMP || (cur->handler >= CMD_JA && cur->handler <= CMD_JNE)) leader[cur->jmp] = true;
+        if (is_leader_end(cur)) leader[cmd_cnt + 1] = true;
+    }
+
+    compile_stubs(&jc);
+
+    for (int cmd_cnt = 0; cmd_cnt <= program->size; ++cmd_cnt)
+    {
+        if (leader[cmd_cnt])
+        {
+            vs_flush(&jc);
+            compile_block(&jc, program, leader, cmd_cnt);
+        }
+        compile_cmd(&jc, program, cmd_cnt);
+    }
+
+    jit->size = jc.size;
+    jit->code = (unsigned char *) mmap(nullptr, jit->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "./CPU: can't allocate memory for JIT\n");
+
+        free(jc.buf);
+        free(jc.block_pos);
+        free(jc.entry);
+        free(jc.fixups);
+        free(leader);
+
+        *jit = {};
+        return false;
+    }
+
+    for (size_t fix_cnt = 0; fix_cnt < jc.fixups_size; ++fix_cnt) patch_rel32(&jc, jc.fixups[fix_cnt].pos, jc.block_pos[jc.fixups[fix_cnt].target]);
+
+    memcpy(jit->code, jc.buf, jit->size);
+    mprotect(jit->code, jit->size, PROT_READ | PROT_EXEC);
+
+    for (int cmd_cnt = 0; cmd_cnt <= program->size; ++cmd_cnt)
+    {
+        jc.entry[cmd_cnt] = jit->code + (leader[cmd_cnt] ? jc.block_pos[cmd_cnt] : jc.bad_entry);
+    }
+    jit->entry = jc.entry;
+
+    free(jc.buf);
+    free(jc.block_pos);
+    free(jc.fixups);
+    free(leader);
+
+    return true;
+#endif
+}
+
+/**
+*   @brief Executes translated code from the instruction "progress->pc" up to the first instruction the code can't execute.
+*
+*   @param jit      [in] - translated program
+*   @param progress [in] - "cpu_store" contains all information about program
+*
+*   @return the reason of the exit
+*/
+
+jit_result jit_run(jit_code *const jit, cpu_store *const progress)
+{
+    assert(jit      != nullptr);
+    assert(progress != nullptr);
+
+    typedef jit_result (*jit_func)(cpu_store *progress, void *entry);
+
+    return ((jit_func) jit->code)(progress, jit->entry[progress->pc]);
+}
+
+void jit_dtor(jit_code *const jit)
+{
+    assert(jit != nullptr);
+
+#ifdef JIT_SUPPORTED
+    if (jit->code != nullptr) munmap(jit->code, jit->size);
+#endif
+    free(jit->entry);
+
+    *jit = {};
+}
+
+/*----------------------------------------------BLOCKS--------------------------------------------------*/
+
+/**
+*   @brief Checks if the next instruction after "cur" must start a new block.
+*/
+
+static bool is_leader_end(const instruction *cur)
+{
+    assert(cur != nullptr);
+
+    switch (cur->handler)
+    {
+        case CMD_PUSH: case CMD_POP:
+        case CMD_ADD : case CMD_SUB: case CMD_MUL: case CMD_DIV:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+/**
+*   @brief Emits the entry of the translated code, the exit and the exits with errors.
+*   @brief The entry has the signature "jit_result (cpu_store *progress, void *entry)".
+*/
+
+static void compile_stubs(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+
+    const int saved[] = {RBX, RBP, R12, R13, R14, R15};
+    const int saved_num = sizeof(saved) / sizeof(saved[0]);
+
+    for (int reg_cnt = 0; reg_cnt < saved_num; ++reg_cnt)
+    {
+        if (saved[reg_cnt] >= R8) emit_byte(jc, 0x41);
+        emit_byte(jc, 0x50 + (saved[reg_cnt] & 7));                 // push reg
+    }
+    emit_alu_ri(jc, 5, RSP, FRAME);                                 // sub  rsp, FRAME
+
+    emit_rr (jc, 0x89, RDI, RBX);                                   // mov  rbx, rdi
+    emit_mem(jc, true, 0x8B, R13, RBX, -1, OFF_STK_DATA);           // mov  r13, [rbx + stk.data]
+    emit_mem(jc, true, 0x8B, RAX, RBX, -1, OFF_STK_SIZE);           // mov  rax, [rbx + stk.size]
+    emit_mem(jc, true, 0x8D, R12, R13, RAX, 0);                     // lea  r12, [r13 + rax * 8]
+    emit_mem(jc, true, 0x8B, RAX, RBX, -1, OFF_STK_CAP);            // mov  rax, [rbx + stk.capacity]
+    emit_mem(jc, true, 0x8D, R14, R13, RAX, 0);                     // lea  r14, [r13 + rax * 8]
+
+    emit_mem(jc, true, 0x8B, RAX, RBX, -1, OFF_CALLS_DATA);         // mov  rax, [rbx + calls.data]
+    emit_mem(jc, true, 0x89, RAX, RSP, -1, 0);                      // mov  [rsp], rax
+    emit_mem(jc, true, 0x8B, RCX, RBX, -1, OFF_CALLS_SIZE);         // mov  rcx, [rbx + calls.size]
+    emit_shift(jc, 4, RCX, 2);                                      // shl  rcx, 2
+    emit_rr (jc, 0x89, RAX, R15);                                   // mov  r15, rax
+    emit_rr (jc, 0x01, RCX, R15);                                   // add  r15, rcx
+    emit_mem(jc, true, 0x8B, RCX, RBX, -1, OFF_CALLS_CAP);          // mov  rcx, [rbx + calls.capacity]
+    emit_shift(jc, 4, RCX, 2);                                      // shl  rcx, 2
+    emit_rr (jc, 0x01, RCX, RAX);                                   // add  rax, rcx
+    emit_mem(jc, true, 0x89, RAX, RSP, -1, 8);                      // mov  [rsp + 8], rax
+
+    emit_byte(jc, 0xFF); emit_byte(jc, 0xE6);                       // jmp  rsi
+
+    jc->epilogue = jc->size;
+
+    emit_rr (jc, 0x89, R12, RCX);                                   // mov  rcx, r12
+    emit_rr (jc, 0x29, R13, RCX);                                   // sub  rcx, r13
+    emit_shift(jc, 5, RCX, 3);                                      // shr  rcx, 3
+    emit_mem(jc, true, 0x89, RCX, RBX, -1, OFF_STK_SIZE);           // mov  [rbx + stk.size], rcx
+    emit_rr (jc, 0x89, R15, RCX);                                   // mov  rcx, r15
+    emit_mem(jc, true, 0x2B, RCX, RSP, -1, 0);                      // sub  rcx, [rsp]
+    emit_shift(jc, 5, RCX, 2);                                      // shr  rcx, 2
+    emit_mem(jc, true, 0x89, RCX, RBX, -1, OFF_CALLS_SIZE);         // mov  [rbx + calls.size], rcx
+
+    emit_alu_ri(jc, 0, RSP, FRAME);                                 // add  rsp, FRAME
+    for (int reg_cnt = saved_num - 1; reg_cnt >= 0; --reg_cnt)
+    {
+        if (saved[reg_cnt] >= R8) emit_byte(jc, 0x41);
+        emit_byte(jc, 0x58 + (saved[reg_cnt] & 7));                 // pop  reg
+    }
+    emit_byte(jc, 0xC3);                                            // ret
+
+    for (int err_cnt = ZERO_DIVISION; err_cnt <= NEG_VALUE; ++err_cnt)
+    {
+        jc->err_stub[err_cnt] = jc->size;
+        emit_mov_ri(jc, RAX, ((stack_el) err_cnt << 32) | JIT_ERROR);
+        emit_jmp_to(jc, jc->epilogue);
+    }
+
+    jc->bad_entry = jc->err_stub[UNDEFINED_CMD];
+}
+
+/**
+*   @brief Emits the beginning of the block: checks if stacks have enough memory for all pushes of the block.
+*
+*   @param jc      [in][out] - compiler
+*   @param program [in]      - decoded program
+*   @param leader  [in]      - leader[i] is true if the instruction i starts a block
+*   @param begin   [in]      - index of the first instruction of the block
+*/
+
+static void compile_block(jit_compiler *jc, const decoded *const program, const bool *leader, const int begin)
+{
+    assert(jc      != nullptr);
+    assert(program != nullptr);
+    assert(leader  != nullptr);
+
+    jc->block_pos[begin] = jc->size;
+
+    int push_num = 0;
+    for (int cmd_cnt = begin; cmd_cnt <= program->size && (cmd_cnt == begin || !leader[cmd_cnt]); ++cmd_cnt)
+    {
+        unsigned char handler = program->cmds[cmd_cnt].handler;
+
+        if (handler == CMD_PUSH || handler == CMD_ADD || handler == CMD_SUB || handler == CMD_MUL || handler == CMD_DIV) ++push_num;
+    }
+
+    size_t jmp_grow_stk   = 0;
+    size_t jmp_grow_calls = 0;
+
+    if (push_num > 0)
+    {
+        emit_mem(jc, true, 0x8D, RAX, R12, -1, push_num * (int) sizeof(stack_el));  // lea  rax, [r12 + push_num * 8]
+        emit_rr (jc, 0x39, R14, RAX);                                               // cmp  rax, r14
+        jmp_grow_stk = emit_jcc(jc, COND_A);
+    }
+    if (program->cmds[begin].handler == CMD_CALL)
+    {
+        emit_mem(jc, true, 0x3B, R15, RSP, -1, 8);                                  // cmp  r15, [rsp + 8]
+        jmp_grow_calls = emit_jcc(jc, COND_AE);
+    }
+    if (jmp_grow_stk == 0 && jmp_grow_calls == 0) return;
+
+    size_t skip = emit_jmp(jc);
+
+    if (jmp_grow_stk   != 0) patch_rel32(jc, jmp_grow_stk  , jc->size);
+    if (jmp_grow_calls != 0) patch_rel32(jc, jmp_grow_calls, jc->size);
+    emit_exit(jc, begin, JIT_GROW, OK);
+
+    patch_rel32(jc, skip, jc->size);
+}
+
+/**
+*   @brief Translates one instruction.
+*
+*   @param jc      [in][out] - compiler
+*   @param program [in]      - decoded program
+*   @param cmd_cnt [in]      - index of the instruction
+*/
+
+static void compile_cmd(jit_compiler *jc, const decoded *const program, const int cmd_cnt)
+{
+    assert(jc      != nullptr);
+    assert(program != nullptr);
+
+    const instruction *cur = program->cmds + cmd_cnt;
+
+    switch (cur->handler)
+    {
+        case CMD_HLT:
+            vs_flush (jc);
+            emit_exit(jc, cmd_cnt + 1, JIT_HALT, OK);
+            break;
+
+        case CMD_NOT_EXICTING:
+            vs_flush (jc);
+            emit_exit(jc, cmd_cnt + 1, JIT_END, OK);
+            break;
+
+        case CMD_PUSH:
+            if (cur->cmd & CMD_MEM_ARG)
+            {
+                if (!(cur->cmd & CMD_REG_ARG))
+                {
+                    if ((stack_el) (long) cur->val >= RAM_NUM)
+                    {
+                        emit_jmp_to(jc, jc->err_stub[MEMORY_LIMIT]);
+                        break;
+                    }
+
+                    int reg = vs_alloc(jc);
+                    emit_mem(jc, true, 0x8B, reg, RBX, -1, OFF_RAM + (int) cur->val * (int) sizeof(stack_el));
+                    vs_push (jc, {VS_HREG, reg, 0});
+                    break;
+                }
+                vs_flush(jc);
+                compile_ram_idx(jc, cur);
+
+                emit_alu_ri(jc, 7, RDX, RAM_NUM);                                   // cmp  rdx, RAM_NUM
+                emit_jcc_to(jc, COND_AE, jc->err_stub[MEMORY_LIMIT]);
+                emit_mem(jc, true, 0x8B, RAX, RBX, RDX, OFF_RAM);                   // mov  rax, [rbx + OFF_RAM + rdx * 8]
+                emit_mem(jc, true, 0x89, RAX, R12, -1, 0);                          // mov  [r12], rax
+                emit_alu_ri(jc, 0, R12, sizeof(stack_el));                          // add  r12, 8
+                break;
+            }
+            if ((cur->cmd & CMD_REG_ARG) && (cur->cmd & CMD_NUM_ARG))
+            {
+                int reg = vs_alloc(jc);
+                emit_mem    (jc, true, 0x8B, reg, RBX, -1, OFF_REGS + cur->reg * (int) sizeof(stack_el));
+                emit_add_val(jc, reg, cur->val);
+                vs_push     (jc, {VS_HREG, reg, 0});
+            }
+            else if (cur->cmd & CMD_REG_ARG) vs_push(jc, {VS_GREG, cur->reg, 0});
+            else                             vs_push(jc, {VS_CONST, 0, cur->val});
+            break;
+
+        case CMD_POP:
+            if (cur->cmd & CMD_MEM_ARG)
+            {
+                vs_entry val = vs_pop(jc);
+
+                if (!(cur->cmd & CMD_REG_ARG))
+                {
+                    if ((stack_el) (long) cur->val >= RAM_NUM)
+                    {
+                        vs_free    (jc, val);
+                        emit_jmp_to(jc, jc->err_stub[MEMORY_LIMIT]);
+                        break;
+                    }
+                    vs_store(jc, val, RBX, -1, OFF_RAM + (int) cur->val * (int) sizeof(stack_el));
+                    emit_mem(jc, false, 0xC6, 0, RBX, -1, OFF_DIRTY + (int) (cur->val >> DIRTY_SHIFT)); // mov  byte [dirty + chunk], 1
+                    emit_byte(jc, 1);
+                    break;
+                }
+                compile_ram_idx(jc, cur);
+
+                emit_alu_ri(jc, 7, RDX, RAM_NUM);                                   // cmp  rdx, RAM_NUM
+                emit_jcc_to(jc, COND_AE, jc->err_stub[MEMORY_LIMIT]);
+                vs_store   (jc, val, RBX, RDX, OFF_RAM);
+
+                emit_shift(jc, 5, RDX, DIRTY_SHIFT);                                // shr  rdx, DIRTY_SHIFT
+                emit_rr   (jc, 0x01, RBX, RDX);                                     // add  rdx, rbx
+                emit_mem  (jc, false, 0xC6, 0, RDX, -1, OFF_DIRTY);                 // mov  byte [rdx + OFF_DIRTY], 1
+                emit_byte (jc, 1);
+                break;
+            }
+            if (cur->cmd & CMD_REG_ARG)
+            {
+                vs_entry val = vs_pop(jc);
+
+                vs_read_greg(jc, cur->reg);
+                vs_store    (jc, val, RBX, -1, OFF_REGS + cur->reg * (int) sizeof(stack_el));
+                break;
+            }
+            vs_drop(jc);
+            break;
+
+        case CMD_ADD: case CMD_SUB: case CMD_MUL: case CMD_DIV:
+            compile_arith(jc, cur->handler);
+            break;
+
+        case CMD_JA : case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE : case CMD_JNE:
+            compile_cond(jc, cur);
+            break;
+
+        case CMD_JMP:
+            vs_flush      (jc);
+            emit_jmp_block(jc, -1, cur->jmp);
+            break;
+
+        case CMD_CALL:
+            vs_flush(jc);
+            emit_mem(jc, false, 0xC7, 0, R15, -1, 0);                               // mov  dword [r15], cmd_cnt + 1
+            emit_int(jc, cmd_cnt + 1);
+            emit_alu_ri   (jc, 0, R15, sizeof(int));                                // add  r15, 4
+            emit_jmp_block(jc, -1, cur->jmp);
+            break;
+
+        case CMD_RET:
+            vs_flush(jc);
+            emit_mem   (jc, true, 0x3B, R15, RSP, -1, 0);                           // cmp  r15, [rsp]
+            emit_jcc_to(jc, COND_BE, jc->err_stub[EMPTY_CALLS]);
+            emit_alu_ri(jc, 5, R15, sizeof(int));                                   // sub  r15, 4
+            emit_mem   (jc, false, 0x8B, RAX, R15, -1, 0);                          // mov  eax, [r15]
+            emit_mov_ri(jc, RDX, (stack_el) jc->entry);                             // mov  rdx, entry
+            emit_mem   (jc, false, 0xFF, 4, RDX, RAX, 0);                           // jmp  [rdx + rax * 8]
+            break;
+
+        default:
+            vs_flush (jc);
+            emit_exit(jc, cmd_cnt, JIT_STEP, OK);
+            break;
+    }
+}
+
+/**
+*   @brief Translates ADD, SUB, MUL and DIV. Folds them if both arguments are constants.
+*/
+
+static void compile_arith(jit_compiler *jc, const unsigned char handler)
+{
+    assert(jc != nullptr);
+
+    vs_entry a = vs_pop(jc);
+    vs_entry b = vs_pop(jc);
+
+    if (a.kind == VS_CONST && b.kind == VS_CONST && (handler != CMD_DIV || a.val != 0))
+    {
+        stack_el res = 0;
+        switch (handler)
+        {
+            case CMD_ADD: res = b.val + a.val; break;
+            case CMD_SUB: res = b.val - a.val; break;
+            case CMD_MUL: res = b.val * a.val; break;
+            default     : res = b.val / a.val; break;
+        }
+        vs_push(jc, {VS_CONST, 0, res});
+        return;
+    }
+
+    int reg_b = vs_to_reg(jc, b);
+    int reg_a = (a.kind == VS_HREG) ? a.reg : ((handler == CMD_DIV) ? RSI : RAX);
+
+    if (a.kind != VS_HREG) vs_load_to(jc, a, reg_a);
+
+    switch (handler)
+    {
+        case CMD_ADD: emit_rr(jc, 0x01,   reg_a, reg_b); break;                   // add  b, a
+        case CMD_SUB: emit_rr(jc, 0x29,   reg_a, reg_b); break;                   // sub  b, a
+        case CMD_MUL: emit_rr(jc, 0x0FAF, reg_b, reg_a); break;                   // imul b, a
+        default:
+            emit_rr    (jc, 0x85, reg_a, reg_a);                                  // test a, a
+            emit_jcc_to(jc, COND_E, jc->err_stub[ZERO_DIVISION]);
+            emit_rr    (jc, 0x89, reg_b, RAX);                                    // mov  rax, b
+            emit_byte  (jc, 0x31); emit_byte(jc, 0xD2);                           // xor  edx, edx
+            emit_rex   (jc, true, 0, 0, reg_a);
+            emit_byte  (jc, 0xF7); emit_byte(jc, 0xF0 | (reg_a & 7));             // div  a
+            emit_rr    (jc, 0x89, RAX, reg_b);                                    // mov  b, rax
+            break;
+    }
+
+    vs_free(jc, a);
+    vs_push(jc, {VS_HREG, reg_b, 0});
+}
+
+/**
+*   @brief Translates conditional jumps. Values are compared like "approx_cmp()" does:
+*   @brief they are equal if they are equal as doubles and are compared as "stack_el" else.
+*/
+
+static void compile_cond(jit_compiler *jc, const instruction *cur)
+{
+    assert(jc  != nullptr);
+    assert(cur != nullptr);
+
+    vs_entry a = vs_pop(jc);
+    vs_entry b = vs_pop(jc);
+
+    vs_flush  (jc);
+    vs_load_to(jc, b, RDI);
+    vs_load_to(jc, a, RSI);
+    vs_free   (jc, a);
+    vs_free   (jc, b);
+
+    bool jmp_if_equal = false;
+    int  cond_if_diff = -1;   // -1 - never, -2 - always
+
+    switch (cur->handler)
+    {
+        case CMD_JA : jmp_if_equal = false; cond_if_diff = COND_A; break;
+        case CMD_JAE: jmp_if_equal = true ; cond_if_diff = COND_A; break;
+        case CMD_JB : jmp_if_equal = false; cond_if_diff = COND_B; break;
+        case CMD_JBE: jmp_if_equal = true ; cond_if_diff = COND_B; break;
+        case CMD_JE : jmp_if_equal = true ; cond_if_diff = -1    ; break;
+        default     : jmp_if_equal = false; cond_if_diff = -2    ; break;
+    }
+
+    emit_rr(jc, 0x39, RSI, RDI);                                                  // cmp  rdi, rsi
+    size_t jmp_equal = emit_jcc(jc, COND_E);
+
+    emit_rr  (jc, 0x89, RDI, RAX);                                                // mov  rax, rdi
+    emit_rr  (jc, 0x09, RSI, RAX);                                                // or   rax, rsi
+    emit_shift(jc, 5, RAX, 53);                                                   // shr  rax, 53
+    size_t jmp_diff = emit_jcc(jc, COND_E);
+
+    emit_byte  (jc, 0x57); emit_byte(jc, 0x56);                                   // push rdi; push rsi
+    emit_mov_ri(jc, RAX, (stack_el) jit_approx_equal);
+    emit_byte  (jc, 0xFF); emit_byte(jc, 0xD0);                                   // call rax
+    emit_byte  (jc, 0x5E); emit_byte(jc, 0x5F);                                   // pop  rsi; pop rdi
+    emit_byte  (jc, 0x84); emit_byte(jc, 0xC0);                                   // test al, al
+    size_t jmp_approx = emit_jcc(jc, COND_NE);
+
+    patch_rel32(jc, jmp_diff, jc->size);
+    if (cond_if_diff == -2) emit_jmp_block(jc, -1, cur->jmp);
+    else if (cond_if_diff != -1)
+    {
+        emit_rr       (jc, 0x39, RSI, RDI);                                       // cmp  rdi, rsi
+        emit_jmp_block(jc, cond_if_diff, cur->jmp);
+    }
+    size_t jmp_done = emit_jmp(jc);
+
+    patch_rel32(jc, jmp_equal , jc->size);
+    patch_rel32(jc, jmp_approx, jc->size);
+    if (jmp_if_equal) emit_jmp_block(jc, -1, cur->jmp);
+
+    patch_rel32(jc, jmp_done, jc->size);
+}
+
+/**
+*   @brief Puts the index of RAM cell of "push [...]" or "pop [...]" with a register in rdx.
+*/
+
+static void compile_ram_idx(jit_compiler *jc, const instruction *cur)
+{
+    assert(jc  != nullptr);
+    assert(cur != nullptr);
+
+    emit_mem(jc, true, 0x8B, RDX, RBX, -1, OFF_REGS + cur->reg * (int) sizeof(stack_el));   // mov  rdx, [regs + reg * 8]
+    if (cur->cmd & CMD_NUM_ARG) emit_add_val(jc, RDX, cur->val);
+}
+
+static bool jit_approx_equal(const stack_el a, const stack_el b)
+{
+    return fabs((double) a - (double) b) < DELTA;
+}
+
+/*--------------------------------------------VIRTUAL_STACK---------------------------------------------*/
+
+/**
+*   @brief Finds free host register for the virtual stack. Writes the bottom of the virtual stack in memory if there are no free registers.
+*
+*   @return number of the host register
+*/
+
+static int vs_alloc(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+
+    while (true)
+    {
+        for (int reg_cnt = 0; reg_cnt < POOL_SIZE; ++reg_cnt)
+        {
+            if (!jc->reg_used[POOL[reg_cnt]])
+            {
+                jc->reg_used[POOL[reg_cnt]] = true;
+                return POOL[reg_cnt];
+            }
+        }
+        assert(jc->vs_size > 0);
+        vs_spill(jc);
+    }
+}
+
+static void vs_free(jit_compiler *jc, const vs_entry entry)
+{
+    assert(jc != nullptr);
+
+    if (entry.kind == VS_HREG) jc->reg_used[entry.reg] = false;
+}
+
+static void vs_push(jit_compiler *jc, const vs_entry entry)
+{
+    assert(jc != nullptr);
+
+    if (jc->vs_size == VS_MAX) vs_spill(jc);
+    jc->vstack[jc->vs_size++] = entry;
+}
+
+/**
+*   @brief Pops the value from the virtual stack. If it is empty, pops the value from "progress->stk" to the host register.
+*/
+
+static vs_entry vs_pop(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+
+    if (jc->vs_size > 0) return jc->vstack[--jc->vs_size];
+
+    int reg = vs_alloc(jc);
+
+    emit_rr    (jc, 0x39, R13, R12);                                              // cmp  r12, r13
+    emit_jcc_to(jc, COND_BE, jc->err_stub[EMPTY_STACK]);
+    emit_mem   (jc, true, 0x8B, reg, R12, -1, -(int) sizeof(stack_el));           // mov  reg, [r12 - 8]
+    emit_alu_ri(jc, 5, R12, sizeof(stack_el));                                    // sub  r12, 8
+
+    return {VS_HREG, reg, 0};
+}
+
+static void vs_drop(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+
+    if (jc->vs_size > 0)
+    {
+        vs_free(jc, jc->vstack[--jc->vs_size]);
+        return;
+    }
+
+    emit_rr    (jc, 0x39, R13, R12);                                              // cmp  r12, r13
+    emit_jcc_to(jc, COND_BE, jc->err_stub[EMPTY_STACK]);
+    emit_alu_ri(jc, 5, R12, sizeof(stack_el));                                    // sub  r12, 8
+}
+
+/**
+*   @brief Writes the value of the virtual stack in memory [base + index * 8 + disp] and frees its host register.
+*/
+
+static void vs_store(jit_compiler *jc, const vs_entry entry, const int base, const int index, const int disp)
+{
+    assert(jc != nullptr);
+
+    switch (entry.kind)
+    {
+        case VS_CONST:
+            if ((long) entry.val == (int) entry.val)
+            {
+                emit_mem(jc, true, 0xC7, 0, base, index, disp);                   // mov  qword [mem], imm32
+                emit_int(jc, (int) entry.val);
+                break;
+            }
+            emit_mov_ri(jc, RAX, entry.val);
+            emit_mem   (jc, true, 0x89, RAX, base, index, disp);
+            break;
+
+        case VS_GREG:
+            emit_mem(jc, true, 0x8B, RAX, RBX, -1, OFF_REGS + entry.reg * (int) sizeof(stack_el));
+            emit_mem(jc, true, 0x89, RAX, base, index, disp);
+            break;
+
+        default:
+            emit_mem(jc, true, 0x89, entry.reg, base, index, disp);
+            vs_free (jc, entry);
+            break;
+    }
+}
+
+static void vs_load_to(jit_compiler *jc, const vs_entry entry, const int dst)
+{
+    assert(jc != nullptr);
+
+    switch (entry.kind)
+    {
+        case VS_CONST: emit_mov_ri(jc, dst, entry.val);                                                        break;
+        case VS_GREG : emit_mem   (jc, true, 0x8B, dst, RBX, -1, OFF_REGS + entry.reg * (int) sizeof(stack_el)); break;
+        default      : if (entry.reg != dst) emit_rr(jc, 0x89, entry.reg, dst);                                 break;
+    }
+}
+
+static int vs_to_reg(jit_compiler *jc, const vs_entry entry)
+{
+    assert(jc != nullptr);
+
+    if (entry.kind == VS_HREG) return entry.reg;
+
+    int reg = vs_alloc(jc);
+    vs_load_to(jc, entry, reg);
+
+    return reg;
+}
+
+/**
+*   @brief Writes the bottom value of the virtual stack in "progress->stk".
+*/
+
+static void vs_spill(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+    assert(jc->vs_size > 0);
+
+    vs_store   (jc, jc->vstack[0], R12, -1, 0);
+    emit_alu_ri(jc, 0, R12, sizeof(stack_el));                                    // add  r12, 8
+
+    --jc->vs_size;
+    memmove(jc->vstack, jc->vstack + 1, jc->vs_size * sizeof(vs_entry));
+}
+
+/**
+*   @brief Writes all values of the virtual stack in "progress->stk".
+*/
+
+static void vs_flush(jit_compiler *jc)
+{
+    assert(jc != nullptr);
+
+    if (jc->vs_size == 0) return;
+
+    for (int vs_cnt = 0; vs_cnt < jc->vs_size; ++vs_cnt) vs_store(jc, jc->vstack[vs_cnt], R12, -1, vs_cnt * (int) sizeof(stack_el));
+    emit_alu_ri(jc, 0, R12, jc->vs_size * (int) sizeof(stack_el));               // add  r12, vs_size * 8
+
+    jc->vs_size = 0;
+}
+
+/**
+*   @brief Reads the guest register "slot" in host registers for all values of the virtual stack which refer to it.
+*   @brief It must be called before changing the guest register.
+*/
+
+static void vs_read_greg(jit_compiler *jc, const int slot)
+{
+    assert(jc != nullptr);
+
+    while (true)
+    {
+        int vs_cnt = 0;
+        while (vs_cnt < jc->vs_size && !(jc->vstack[vs_cnt].kind == VS_GREG && jc->vstack[vs_cnt].reg == slot)) ++vs_cnt;
+
+        if (vs_cnt == jc->vs_size) return;
+
+        int reg = vs_alloc(jc);
+
+        vs_cnt = 0;
+        while (vs_cnt < jc->vs_size && !(jc->vstack[vs_cnt].kind == VS_GREG && jc->vstack[vs_cnt].reg == slot)) ++vs_cnt;
+
+        if (vs_cnt == jc->vs_size)
+        {
+            jc->reg_used[reg] = false;
+            return;
+        }
+        vs_load_to(jc, jc->vstack[vs_cnt], reg);
+        jc->vstack[vs_cnt] = {VS_HREG, reg, 0};
+    }
+}
+
+/*-----------------------------------------------EMITTER------------------------------------------------*/
+
+static void emit_byte(jit_compiler *jc, const unsigned char val)
+{
+    assert(jc != nullptr);
+
+    if (jc->size == jc->capacity)
+    {
+        jc->capacity *= 2;
+        jc->buf       = (unsigned char *) realloc(jc->buf, jc->capacity);
+        assert(jc->buf != nullptr);
+    }
+    jc->buf[jc->size++] = val;
+}
+
+static void emit_int(jit_compiler *jc, const int val)
+{
+    for (size_t byte_cnt = 0; byte_cnt < sizeof(int); ++byte_cnt) emit_byte(jc, (unsigned char) ((unsigned) val >> (8 * byte_cnt)));
+}
+
+static void emit_long(jit_compiler *jc, const stack_el val)
+{
+    for (size_t byte_cnt = 0; byte_cnt < sizeof(stack_el); ++byte_cnt) emit_byte(jc, (unsigned char) (val >> (8 * byte_cnt)));
+}
+
+static void emit_rex(jit_compiler *jc, const bool wide, const int reg, const int index, const int base)
+{
+    unsigned char rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+
+    if (rex != 0x40) emit_byte(jc, rex);
+}
+
+static void emit_opcode(jit_compiler *jc, const int opcode)
+{
+    if (opcode > 0xFF) emit_byte(jc, (unsigned char) (opcode >> 8));
+    emit_byte(jc, (unsigned char) opcode);
+}
+
+/**
+*   @brief Emits 64-bit "opcode" with two register operands ("reg" in ModRM.reg and "rm" in ModRM.rm).
+*/
+
+static void emit_rr(jit_compiler *jc, const int opcode, const int reg, const int rm)
+{
+    emit_rex   (jc, true, reg, 0, rm);
+    emit_opcode(jc, opcode);
+    emit_byte  (jc, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+*   @brief Emits "opcode" with the memory operand [base + index * 8 + disp] ("index" is -1 if there is no index).
+*/
+
+static void emit_mem(jit_compiler *jc, const bool wide, const int opcode, const int reg, const int base, const int index, const int disp)
+{
+    emit_rex   (jc, wide, reg, (index < 0) ? 0 : index, base);
+    emit_opcode(jc, opcode);
+
+    if (index < 0 && (base & 7) != RSP) emit_byte(jc, 0x80 | ((reg & 7) << 3) | (base & 7));
+    else
+    {
+        emit_byte(jc, 0x80 | ((reg & 7) << 3) | RSP);
+        emit_byte(jc, ((index < 0) ? 0 : 0xC0) | (((index < 0) ? RSP : index) & 7) << 3 | (base & 7));
+    }
+    emit_int(jc, disp);
+}
+
+static void emit_mov_ri(jit_compiler *jc, const int dst, const stack_el val)
+{
+    if (val <= 0xFFFFFFFF)
+    {
+        emit_rex (jc, false, 0, 0, dst);
+        emit_byte(jc, 0xB8 + (dst & 7));                                          // mov  r32, imm32
+        emit_int (jc, (int) val);
+        return;
+    }
+    emit_rex (jc, true, 0, 0, dst);
+    emit_byte(jc, 0xB8 + (dst & 7));                                              // mov  r64, imm64
+    emit_long(jc, val);
+}
+
+/**
+*   @brief Emits "op dst, imm32" where "ext" is 0 for add, 5 for sub, 7 for cmp.
+*/
+
+static void emit_alu_ri(jit_compiler *jc, const int ext, const int dst, const int val)
+{
+    emit_rex (jc, true, 0, 0, dst);
+    emit_byte(jc, 0x81);
+    emit_byte(jc, 0xC0 | (ext << 3) | (dst & 7));
+    emit_int (jc, val);
+}
+
+/**
+*   @brief Emits "op dst, imm8" where "ext" is 4 for shl, 5 for shr.
+*/
+
+static void emit_shift(jit_compiler *jc, const int ext, const int dst, const int val)
+{
+    emit_rex (jc, true, 0, 0, dst);
+    emit_byte(jc, 0xC1);
+    emit_byte(jc, 0xC0 | (ext << 3) | (dst & 7));
+    emit_byte(jc, (unsigned char) val);
+}
+
+static void emit_add_val(jit_compiler *jc, const int dst, const stack_el val)
+{
+    if ((long) val == (int) val)
+    {
+        emit_alu_ri(jc, 0, dst, (int) val);
+        return;
+    }
+    emit_mov_ri(jc, RAX, val);
+    emit_rr    (jc, 0x01, RAX, dst);                                              // add  dst, rax
+}
+
+static size_t emit_jcc(jit_compiler *jc, const int cond)
+{
+    emit_byte(jc, 0x0F);
+    emit_byte(jc, 0x80 + cond);
+    emit_int (jc, 0);
+
+    return jc->size - sizeof(int);
+}
+
+static size_t emit_jmp(jit_compiler *jc)
+{
+    emit_byte(jc, 0xE9);
+    emit_int (jc, 0);
+
+    return jc->size - sizeof(int);
+}
+
+static void emit_jcc_to(jit_compiler *jc, const int cond, const size_t target)
+{
+    patch_rel32(jc, emit_jcc(jc, cond), target);
+}
+
+static void emit_jmp_to(jit_compiler *jc, const size_t target)
+{
+    patch_rel32(jc, emit_jmp(jc), target);
+}
+
+/**
+*   @brief Emits the jump to the block "target" which position becomes known later. "cond" is -1 for the unconditional jump.
+*/
+
+static void emit_jmp_block(jit_compiler *jc, const int cond, const int target)
+{
+    size_t pos = (cond == -1) ? emit_jmp(jc) : emit_jcc(jc, cond);
+
+    if (jc->fixups_size == jc->fixups_capacity)
+    {
+        jc->fixups_capacity = (jc->fixups_capacity == 0) ? 64 : 2 * jc->fixups_capacity;
+        jc->fixups          = (jit_fixup *) realloc(jc->fixups, jc->fixups_capacity * sizeof(jit_fixup));
+        assert(jc->fixups != nullptr);
+    }
+    jc->fixups[jc->fixups_size++] = {pos, target};
+}
+
+/**
+*   @brief Emits the exit from the translated code with "progress->pc" equal to "pc".
+*/
+
+static void emit_exit(jit_compiler *jc, const int pc, const JIT_EXIT exit, const int error)
+{
+    emit_mem   (jc, false, 0xC7, 0, RBX, -1, OFF_PC);                             // mov  dword [rbx + pc], pc
+    emit_int   (jc, pc);
+    emit_mov_ri(jc, RAX, ((stack_el) error << 32) | exit);
+    emit_jmp_to(jc, jc->epilogue);
+}
+
+static void patch_rel32(jit_compiler *jc, const size_t pos, const size_t target)
+{
+    int rel = (int) (target - (pos + sizeof(int)));
+    memcpy(jc->buf + pos, &rel, sizeof(int));
+}
@@ -0,0 +1,33 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "cpu.h"
+
+enum JIT_EXIT
+{
+    JIT_STEP  , // the instruction "progress->pc" must be executed by the interpreter
+    JIT_GROW  , // stacks must be reserved before executing the block "progress->pc"
+    JIT_HALT  , // "HLT" is executed
+    JIT_END   , // the end of the program is reached
+    JIT_ERROR   // "jit_result::error" contains the code of the error
+};
+
+struct jit_result
+{
+    int exit;
+    int error;
+};
+
+struct jit_code
+{
+    unsigned char *code;
+    size_t         size;
+
+    void **entry; // native address of every instruction starting a block
+};
+
+bool       jit_compile (jit_code *const jit, const decoded *const program);
+jit_result jit_run     (jit_code *const jit, cpu_store *const progress);
+void       jit_dtor    (jit_code *const jit);
+
+#endif //JIT_H
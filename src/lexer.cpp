@@ -0,0 +1,371 @@
+/** @file */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LEX_X86
+#include <immintrin.h>
+#endif
+
+#include "lexer.h"
+
+static size_t lex_skip_scalar  (const char *s, size_t pos, const size_t size, int *const lines);
+static size_t lex_token_scalar (const char *s, size_t pos, const size_t size, const char sep1, const char sep2);
+static size_t lex_longs_scalar (const char *s, size_t pos, const size_t size, int *const lines, long *const vals, size_t *const num);
+
+#ifdef LEX_X86
+static size_t lex_skip_sse2    (const char *s, size_t pos, const size_t size, int *const lines);
+static size_t lex_token_sse2   (const char *s, size_t pos, const size_t size, const char sep1, const char sep2);
+static size_t lex_skip_avx2    (const char *s, size_t pos, const size_t size, int *const lines);
+static size_t lex_token_avx2   (const char *s, size_t pos, const size_t size, const char sep1, const char sep2);
+static size_t lex_longs_sse2   (const char *s, size_t pos, const size_t size, int *const lines, long *const vals, size_t *const num);
+static long   swar_digits      (const char *s, const unsigned len);
+#endif
+
+static const lexer lex_kernels[LEX_KERNEL_NUM] =
+{
+    {lex_skip_scalar, lex_token_scalar, lex_longs_scalar},
+#ifdef LEX_X86
+    {lex_skip_sse2  , lex_token_sse2  , lex_longs_sse2  },
+    {lex_skip_avx2  , lex_token_avx2  , lex_longs_sse2  },  // the numbers are shorter than 16 characters, a wider load doesn't help
+#endif
+};
+
+static const lexer *lex_chosen = nullptr;
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Gets the lexer kernel: the functions splitting the source into tokens and parsing integers.
+*
+*   @param kernel [in] - kernel to get
+*
+*   @return the kernel or nullptr if the processor doesn't support it
+*/
+
+const lexer *lex_get(const LEX_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case LEX_SCALAR: return lex_kernels + LEX_SCALAR;
+
+#ifdef LEX_X86
+        case LEX_SSE2:   return lex_kernels + LEX_SSE2;
+        case LEX_AVX2:   return __builtin_cpu_supports("avx2") ? lex_kernels + LEX_AVX2 : nullptr;
+#endif
+
+        default:         return nullptr;
+    }
+}
+
+const char *lex_name(const LEX_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case LEX_SCALAR: return "scalar";
+        case LEX_SSE2:   return "sse2";
+        case LEX_AVX2:   return "avx2";
+        default:         return "unknown";
+    }
+}
+
+/**
+*   @brief Gets the best lexer kernel supported by the processor. The kernel is chosen at the first call.
+*/
+
+const lexer *lex_best()
+{
+    if (lex_chosen == nullptr)
+    {
+        for (int kernel = LEX_KERNEL_NUM - 1; lex_chosen == nullptr; --kernel) lex_chosen = lex_get((LEX_KERNEL) kernel);
+    }
+
+    return lex_chosen;
+}
+
+static size_t lex_skip_scalar(const char *s, size_t pos, const size_t size, int *const lines)
+{
+    int cur_char = 0;
+
+    while (pos < size && isspace(cur_char = s[pos]))
+    {
+        if (cur_char == '\n') ++*lines;
+
+        ++pos;
+    }
+    return pos;
+}
+
+static size_t lex_token_scalar(const char *s, size_t pos, const size_t size, const char sep1, const char sep2)
+{
+    int cur_char = 0;
+
+    while (pos < size && !isspace(cur_char = s[pos]) && cur_char != sep1 && cur_char != sep2) ++pos;
+
+    return pos;
+}
+
+/**
+*   @brief Reads the tokens one by one and parses them by "lex_long()".
+*
+*   @return position after the last read integer or position of the first token which is not an integer
+*/
+
+static size_t lex_longs_scalar(const char *s, size_t pos, const size_t size, int *const lines, long *const vals, size_t *const num)
+{
+    size_t read_num = 0;
+
+    for (; read_num < *num; ++read_num)
+    {
+        pos = lex_skip_scalar(s, pos, size, lines);
+
+        size_t end = lex_token_scalar(s, pos, size, ' ', ' ');
+        if (!lex_long(s + pos, (int) (end - pos), vals + read_num)) break;
+
+        pos = end;
+    }
+
+    *num = read_num;
+    return pos;
+}
+
+/**
+*   @brief Checks if "s" of "len" characters is valid long as "strtol()" in base 10 does: optional sign and decimal digits.
+*   @brief Puts the value in "val", it is saturated to LONG_MIN or LONG_MAX in case of overflow.
+*
+*   @param s   [in]  - pointer to the first character to check
+*   @param len [in]  - number of characters to check
+*   @param val [out] - pointer to the "long" variable to put the result
+*
+*   @return true if argument is valid and false else
+*
+*   @note you should ignore "*val" if "lex_long()" returns false
+*/
+
+bool lex_long(const char *s, const int len, long *const val)
+{
+    assert(s   != nullptr);
+    assert(val != nullptr);
+
+    int  pos    = 0;
+    bool is_neg = false;
+
+    if (len > 0 && (s[0] == '-' || s[0] == '+'))
+    {
+        is_neg = (s[0] == '-');
+        ++pos;
+    }
+    if (pos == len) return false;
+
+    unsigned long limit = is_neg ? (unsigned long) LONG_MAX + 1 : (unsigned long) LONG_MAX;
+    unsigned long num   = 0;
+
+    for (; pos < len; ++pos)
+    {
+        if (s[pos] < '0' || s[pos] > '9') return false;
+
+        unsigned long digit = (unsigned long) (s[pos] - '0');
+
+        num = (num > (limit - digit) / 10) ? limit : 10 * num + digit;
+    }
+
+    *val = is_neg ? (long) (0 - num) : (long) num;
+    return true;
+}
+
+#ifdef LEX_X86
+
+/**
+*   @brief Mask of the characters "isspace()" is true for in the "C" locale: ' ' and '\t', '\n', '\v', '\f', '\r' (9..13).
+*/
+
+static inline unsigned space_mask_sse2(const __m128i chars)
+{
+    __m128i ctrl = _mm_sub_epi8(chars, _mm_set1_epi8(9));
+            ctrl = _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8(4)), ctrl);
+
+    return (unsigned) _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '))));
+}
+
+/**
+*   @brief Tests 16 characters per step, the newlines before the first non-space character are counted by popcount.
+*/
+
+static size_t lex_skip_sse2(const char *s, size_t pos, const size_t size, int *const lines)
+{
+    for (; pos + 16 <= size; pos += 16)
+    {
+        __m128i  chars   = _mm_loadu_si128((const __m128i *) (s + pos));
+        unsigned space   = space_mask_sse2(chars);
+        unsigned newline = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+
+        if (space != 0xFFFF)
+        {
+            unsigned skip_num = (unsigned) __builtin_ctz(~space);
+
+            *lines += __builtin_popcount(newline & ((1u << skip_num) - 1));
+            return pos + skip_num;
+        }
+        *lines += __builtin_popcount(newline);
+    }
+
+    return lex_skip_scalar(s, pos, size, lines);
+}
+
+static size_t lex_token_sse2(const char *s, size_t pos, const size_t size, const char sep1, const char sep2)
+{
+    for (; pos + 16 <= size; pos += 16)
+    {
+        __m128i  chars = _mm_loadu_si128((const __m128i *) (s + pos));
+        __m128i  seps  = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(sep1)), _mm_cmpeq_epi8(chars, _mm_set1_epi8(sep2)));
+        unsigned stop  = space_mask_sse2(chars) | (unsigned) _mm_movemask_epi8(seps);
+
+        if (stop != 0) return pos + (unsigned) __builtin_ctz(stop);
+    }
+
+    return lex_token_scalar(s, pos, size, sep1, sep2);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned space_mask_avx2(const __m256i chars)
+{
+    __m256i ctrl = _mm256_sub_epi8(chars, _mm256_set1_epi8(9));
+            ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8(4)), ctrl);
+
+    return (unsigned) _mm256_movemask_epi8(_mm256_or_si256(ctrl, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' '))));
+}
+
+/**
+*   @brief The same as "lex_skip_sse2()" with 32 characters per step, the tail is finished by the SSE2 kernel.
+*/
+
+__attribute__((target("avx2")))
+static size_t lex_skip_avx2(const char *s, size_t pos, const size_t size, int *const lines)
+{
+    for (; pos + 32 <= size; pos += 32)
+    {
+        __m256i  chars   = _mm256_loadu_si256((const __m256i *) (s + pos));
+        unsigned space   = space_mask_avx2(chars);
+        unsigned newline = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n')));
+
+        if (space != 0xFFFFFFFF)
+        {
+            unsigned skip_num = (unsigned) __builtin_ctz(~space);
+
+            *lines += __builtin_popcount(newline & (unsigned) ((1ull << skip_num) - 1));
+            return pos + skip_num;
+        }
+        *lines += __builtin_popcount(newline);
+    }
+
+    return lex_skip_sse2(s, pos, size, lines);
+}
+
+__attribute__((target("avx2")))
+static size_t lex_token_avx2(const char *s, size_t pos, const size_t size, const char sep1, const char sep2)
+{
+    for (; pos + 32 <= size; pos += 32)
+    {
+        __m256i  chars = _mm256_loadu_si256((const __m256i *) (s + pos));
+        __m256i  seps  = _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(sep1)), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(sep2)));
+        unsigned stop  = space_mask_avx2(chars) | (unsigned) _mm256_movemask_epi8(seps);
+
+        if (stop != 0) return pos + (unsigned) __builtin_ctz(stop);
+    }
+
+    return lex_token_sse2(s, pos, size, sep1, sep2);
+}
+
+/**
+*   @brief Classifies 16 characters at once and reads all the numbers of the block: every run of digits must be followed by a space.
+*   @brief Unsigned numbers of up to 15 digits are converted by "swar_digits()", the other tokens and the tail of the source
+*   @brief are left to the scalar kernel, so it decides whether they are valid.
+*/
+
+static size_t lex_longs_sse2(const char *s, size_t pos, const size_t size, int *const lines, long *const vals, size_t *const num)
+{
+    size_t read_num = 0;
+
+    while (read_num < *num)
+    {
+        pos = lex_skip_sse2(s, pos, size, lines);
+        if (pos + 16 > size) break;
+
+        __m128i  chars   = _mm_loadu_si128((const __m128i *) (s + pos));
+        __m128i  value   = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+        unsigned digit   = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(value, _mm_set1_epi8(9)), value));
+        unsigned space   = space_mask_sse2(chars);
+        unsigned newline = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+
+        unsigned beg = 0;
+        unsigned end = 0;
+
+        while (true)
+        {
+            end = beg + (unsigned) __builtin_ctz(~(digit >> beg));
+
+            if (end == beg || end >= 16 || !((space >> end) & 1) || pos + beg + 8 > size) break;
+
+            vals[read_num++] = swar_digits(s + pos + beg, end - beg);
+            if (read_num == *num) break;
+
+            unsigned next_token = ~space & (0xFFFF << end) & 0xFFFF;
+            if (next_token == 0)
+            {
+                *lines += __builtin_popcount(newline >> end);
+                beg     = 16;
+                break;
+            }
+
+            unsigned next = (unsigned) __builtin_ctz(next_token);
+
+            *lines += __builtin_popcount(newline & ((1u << next) - 1) & (0xFFFF << end));
+            beg     = next;
+        }
+
+        if (read_num == *num) return pos + end;
+        if (beg == 0) break;    // the token is not a short number, it is left to the scalar kernel
+
+        pos += beg;
+    }
+
+    size_t tail_num = *num - read_num;
+    pos = lex_longs_scalar(s, pos, size, lines, vals + read_num, &tail_num);
+
+    *num = read_num + tail_num;
+    return pos;
+}
+
+/**
+*   @brief Converts "len" < 16 decimal digits by 8-digit words: the word is shifted so the missing high digits become zeros,
+*   @brief then the neighbouring digits, pairs and quads are joined by three multiplications.
+*
+*   @note 16 bytes from "s" must be readable
+*/
+
+static inline uint64_t swar_word(const char *s, const unsigned len)
+{
+    uint64_t word = 0;
+    memcpy(&word, s, sizeof(uint64_t));
+
+    word  = (word - 0x3030303030303030) << (8 * (8 - len));
+    word  = (word * 10    + (word >> 8))  & 0x00FF00FF00FF00FF;
+    word  = (word * 100   + (word >> 16)) & 0x0000FFFF0000FFFF;
+    word  = (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFF;
+
+    return word;
+}
+
+static long swar_digits(const char *s, const unsigned len)
+{
+    if (len <= 8) return (long) swar_word(s, len);
+
+    return (long) (swar_word(s, len - 8) * 100000000 + swar_word(s + len - 8, 8));
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+
+enum LEX_KERNEL
+{
+    LEX_SCALAR ,
+    LEX_SSE2   ,
+    LEX_AVX2   ,
+
+    LEX_KERNEL_NUM
+};
+
+typedef size_t (*lex_skip_func)  (const char *s, size_t pos, const size_t size, int *const lines);
+typedef size_t (*lex_token_func) (const char *s, size_t pos, const size_t size, const char sep1, const char sep2);
+typedef size_t (*lex_longs_func) (const char *s, size_t pos, const size_t size, int *const lines, long *const vals, size_t *const num);
+
+struct lexer
+{
+    lex_skip_func  skip_spaces; // position of the first non-space character, "*lines" is increased by the number of skipped '\n'
+    lex_token_func token_end;   // position of the first space, "sep1" or "sep2" character
+    lex_longs_func read_longs;  // up to "*num" space-separated integers, "*num" is set to the number of read ones
+};
+
+const lexer *lex_get  (const LEX_KERNEL kernel);
+const char  *lex_name (const LEX_KERNEL kernel);
+const lexer *lex_best ();
+bool         lex_long (const char *s, const int len, long *const val);
+
+#endif //LEXER_H
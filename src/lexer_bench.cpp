@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#include "read_write.h"
+#include "lexer.h"
+
+const int    REPEAT_NUM = 10;
+const size_t LONG_BATCH = 256;
+
+struct lex_stat
+{
+    size_t token_num;
+    size_t long_num;
+    long   long_sum;
+    int    line_num;
+};
+
+double   get_time  ();
+lex_stat lex_all   (const lexer *const kernel, const char *src, const size_t src_size);
+
+/**
+*   @brief Measures speed of the lexer kernels splitting the source into tokens the way "Asm2" does:
+*   @brief the integers are read in batches as "push_many" and "pop_many" arguments, the other tokens are skipped.
+*
+*   @brief The best of the passes is reported, so the noise of a loaded machine is not counted.
+*
+*   Usage: ./lexer_bench <source> [number of passes]
+*/
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <source> [number of passes]\n", argv[0]);
+        return 1;
+    }
+
+    int repeat_num = (argc > 2) ? atoi(argv[2]) : REPEAT_NUM;
+    if (repeat_num <= 0) repeat_num = REPEAT_NUM;
+
+    size_t      src_size = 0;
+    const char *src      = (const char *) map_file(argv[1], &src_size);
+    if (src == nullptr)
+    {
+        fprintf(stderr, "Can't open the source \"%s\"\n", argv[1]);
+        return 1;
+    }
+
+    lex_stat ref = lex_all(lex_get(LEX_SCALAR), src, src_size);
+    printf("%zu tokens, %zu integers, %d lines\n", ref.token_num, ref.long_num, ref.line_num);
+
+    for (int kernel = 0; kernel < LEX_KERNEL_NUM; ++kernel)
+    {
+        const lexer *lex = lex_get((LEX_KERNEL) kernel);
+        if (lex == nullptr)
+        {
+            printf("%-8s is not supported\n", lex_name((LEX_KERNEL) kernel));
+            continue;
+        }
+
+        lex_stat stat = lex_all(lex, src, src_size);
+        if (stat.token_num != ref.token_num || stat.long_num != ref.long_num || stat.long_sum != ref.long_sum || stat.line_num != ref.line_num)
+        {
+            printf("%-8s gives wrong tokens\n", lex_name((LEX_KERNEL) kernel));
+            continue;
+        }
+
+        double best = 0;
+        for (int repeat_cnt = 0; repeat_cnt < repeat_num; ++repeat_cnt)
+        {
+            double start = get_time();
+            lex_all(lex, src, src_size);
+            double sec = get_time() - start;
+
+            if (repeat_cnt == 0 || sec < best) best = sec;
+        }
+
+        printf("%-8s %8.2f MB/s\n", lex_name((LEX_KERNEL) kernel), (double) src_size / best / 1e6);
+    }
+
+    unmap_file(src, src_size);
+}
+
+lex_stat lex_all(const lexer *const kernel, const char *src, const size_t src_size)
+{
+    assert(kernel != nullptr);
+    assert(src    != nullptr);
+
+    lex_stat stat = {};
+    long     vals[LONG_BATCH] = {};
+    size_t   pos  = 0;
+
+    while (pos < src_size)
+    {
+        size_t read_num = LONG_BATCH;
+        pos = kernel->read_longs(src, pos, src_size, &stat.line_num, vals, &read_num);
+
+        for (size_t cnt = 0; cnt < read_num; ++cnt) stat.long_sum += vals[cnt];
+        stat.long_num  += read_num;
+        stat.token_num += read_num;
+
+        if (read_num == LONG_BATCH) continue;
+
+        pos = kernel->skip_spaces(src, pos, src_size, &stat.line_num);
+        if (pos == src_size) break;
+
+        size_t end = kernel->token_end(src, pos, src_size, ' ', ' ');
+        if    (end == pos) ++end;
+
+        ++stat.token_num;
+        pos = end;
+    }
+
+    return stat;
+}
+
+double get_time()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
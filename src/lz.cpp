@@ -0,0 +1,220 @@
+/** @file */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "lz.h"
+
+const size_t LZ_MIN_MATCH  = 4;
+const size_t LZ_MAX_OFFSET = 65535;
+const size_t LZ_LEN_MAX    = 15;    // length in the token, the bigger lengths continue after it
+const int    LZ_HASH_BITS  = 16;
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static unsigned char *write_seq  (unsigned char *out, const unsigned char *lit, const size_t lit_len, const size_t offset, const size_t match_len);
+static unsigned char *write_len  (unsigned char *out, size_t len);
+static bool           read_len   (const unsigned char *in, const size_t in_size, size_t *const in_pos, size_t *const len);
+static uint32_t       read_u32   (const unsigned char *ptr);
+static uint32_t       lz_hash    (const uint32_t seq);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Counts the maximal size of the compressed block.
+*
+*   @param src_size [in] - size (in bytes) of the block
+*
+*   @return size of the buffer for "lz_compress()"
+*/
+
+size_t lz_bound(const size_t src_size)
+{
+    return src_size + src_size / 255 + 16;
+}
+
+/**
+*   @brief Compresses the block. Matches are found by the hash table of the last positions of every 4 bytes.
+*
+*   @param src      [in]  - block to compress
+*   @param src_size [in]  - size (in bytes) of the block
+*   @param dst      [out] - buffer of "lz_bound(src_size)" bytes
+*
+*   @return size of the compressed block
+*/
+
+size_t lz_compress(const void *src, const size_t src_size, void *const dst)
+{
+    assert(src != nullptr);
+    assert(dst != nullptr);
+
+    const unsigned char *in  = (const unsigned char *) src;
+    unsigned char       *out = (unsigned char *)       dst;
+
+    uint32_t *table = (uint32_t *) calloc((size_t) 1 << LZ_HASH_BITS, sizeof(uint32_t));
+    assert(table != nullptr);
+
+    size_t anchor = 0;  // the first literal which is not written yet
+    size_t pos    = 0;
+
+    while (pos + LZ_MIN_MATCH <= src_size)
+    {
+        uint32_t seq  = read_u32(in + pos);
+        uint32_t hash = lz_hash(seq);
+        size_t   cand = table[hash];
+
+        table[hash] = (uint32_t) pos;
+
+        if (cand >= pos || pos - cand > LZ_MAX_OFFSET || read_u32(in + cand) != seq)
+        {
+            ++pos;
+            continue;
+        }
+
+        size_t match_len = LZ_MIN_MATCH;
+        while (pos + match_len < src_size && in[cand + match_len] == in[pos + match_len]) ++match_len;
+
+        out    = write_seq(out, in + anchor, pos - anchor, pos - cand, match_len);
+        pos   += match_len;
+        anchor = pos;
+    }
+    out = write_seq(out, in + anchor, src_size - anchor, 0, 0);
+
+    free(table);
+
+    return (size_t) (out - (unsigned char *) dst);
+}
+
+/**
+*   @brief Decompresses the block. Every length and offset is checked, so a damaged block is not written out of "dst".
+*
+*   @param src      [in]  - compressed block
+*   @param src_size [in]  - size (in bytes) of the compressed block
+*   @param dst      [out] - buffer of "dst_size" bytes
+*   @param dst_size [in]  - size (in bytes) of the block
+*
+*   @return true if the block is decompressed in exactly "dst_size" bytes and false else
+*/
+
+bool lz_decompress(const void *src, const size_t src_size, void *const dst, const size_t dst_size)
+{
+    assert(src != nullptr);
+    assert(dst != nullptr);
+
+    const unsigned char *in  = (const unsigned char *) src;
+    unsigned char       *out = (unsigned char *)       dst;
+
+    size_t in_pos  = 0;
+    size_t out_pos = 0;
+
+    while (in_pos < src_size)
+    {
+        unsigned char token = in[in_pos++];
+
+        size_t lit_len = token >> 4;
+        if (lit_len == LZ_LEN_MAX && !read_len(in, src_size, &in_pos, &lit_len)) return false;
+        if (lit_len > src_size - in_pos || lit_len > dst_size - out_pos)        return false;
+
+        memcpy(out + out_pos, in + in_pos, lit_len);
+        in_pos  += lit_len;
+        out_pos += lit_len;
+
+        if (in_pos == src_size) break;  // the last sequence has no match
+        if (src_size - in_pos < 2) return false;
+
+        size_t offset = (size_t) in[in_pos] | (size_t) in[in_pos + 1] << 8;
+        in_pos += 2;
+
+        size_t match_len = token & LZ_LEN_MAX;
+        if (match_len == LZ_LEN_MAX && !read_len(in, src_size, &in_pos, &match_len)) return false;
+        match_len += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > out_pos || match_len > dst_size - out_pos) return false;
+
+        if (offset >= match_len) memcpy(out + out_pos, out + out_pos - offset, match_len);
+        else
+        {
+            for (size_t byte_cnt = 0; byte_cnt < match_len; ++byte_cnt) out[out_pos + byte_cnt] = out[out_pos + byte_cnt - offset];
+        }
+        out_pos += match_len;
+    }
+
+    return out_pos == dst_size;
+}
+
+/**
+*   @brief Writes the sequence: the token, the literals and the match if "offset" is not 0.
+*
+*   @return position after the sequence
+*/
+
+static unsigned char *write_seq(unsigned char *out, const unsigned char *lit, const size_t lit_len, const size_t offset, const size_t match_len)
+{
+    unsigned char *token = out++;
+
+    *token = (unsigned char) ((lit_len < LZ_LEN_MAX ? lit_len : LZ_LEN_MAX) << 4);
+    if (lit_len >= LZ_LEN_MAX) out = write_len(out, lit_len - LZ_LEN_MAX);
+
+    memcpy(out, lit, lit_len);
+    out += lit_len;
+
+    if (offset == 0) return out;
+
+    *out++ = (unsigned char) (offset & 0xFF);
+    *out++ = (unsigned char) (offset >> 8);
+
+    size_t len_code = match_len - LZ_MIN_MATCH;
+
+    *token |= (unsigned char) (len_code < LZ_LEN_MAX ? len_code : LZ_LEN_MAX);
+    if (len_code >= LZ_LEN_MAX) out = write_len(out, len_code - LZ_LEN_MAX);
+
+    return out;
+}
+
+/**
+*   @brief Writes the rest of the length: bytes of 255 and one less byte.
+*/
+
+static unsigned char *write_len(unsigned char *out, size_t len)
+{
+    for (; len >= 255; len -= 255) *out++ = 255;
+    *out++ = (unsigned char) len;
+
+    return out;
+}
+
+/**
+*   @brief Reads the rest of the length written by "write_len()" and adds it to "len".
+*
+*   @return true if the length is inside the block and false else
+*/
+
+static bool read_len(const unsigned char *in, const size_t in_size, size_t *const in_pos, size_t *const len)
+{
+    unsigned char byte = 255;
+
+    while (byte == 255)
+    {
+        if (*in_pos >= in_size) return false;
+
+        byte  = in[(*in_pos)++];
+        *len += byte;
+    }
+
+    return true;
+}
+
+static uint32_t read_u32(const unsigned char *ptr)
+{
+    uint32_t val = 0;
+    memcpy(&val, ptr, sizeof(uint32_t));
+
+    return val;
+}
+
+static uint32_t lz_hash(const uint32_t seq)
+{
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
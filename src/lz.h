@@ -0,0 +1,16 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+
+/*
+ * LZ77 codec of blocks in the format of LZ4 blocks: every sequence is a token (high 4 bits - number of literals,
+ * low 4 bits - length of the match minus LZ_MIN_MATCH, 15 means that the bytes of 255 and one less byte follow),
+ * the literals, 2 bytes of the offset of the match and the rest of the length. The last sequence has only literals.
+ */
+
+size_t lz_bound      (const size_t src_size);
+size_t lz_compress   (const void *src, const size_t src_size, void *const dst);
+bool   lz_decompress (const void *src, const size_t src_size, void *const dst, const size_t dst_size);
+
+#endif //LZ_H
@@ -0,0 +1,144 @@
+#ifndef MNEMONIC_H
+#define MNEMONIC_H
+
+#include <stddef.h>
+
+#include "machine.h"
+
+/*
+ * Recognizer of command names generated at compile time from "cmd.h".
+ * The key of the name is its length, its first two and its last characters (case-insensitive).
+ * The multiplier of the hash is chosen at compile time so that different names get different slots of the table,
+ * so recognizing a token takes one hash and at most MNEMONIC_MAX_LEN character compares.
+ */
+
+struct mnemonic
+{
+    const char *name;
+    size_t      len;
+    CMD         cmd;
+};
+
+#define DEF_CMD(name, ...)                              \
+        {#name, sizeof(#name) - 1, CMD_##name},
+
+#define DEF_JMP_CMD(name, ...)                          \
+        {#name, sizeof(#name) - 1, CMD_##name},
+
+constexpr mnemonic MNEMONICS[] =
+{
+    #include "cmd.h"
+};
+
+#undef DEF_CMD
+#undef DEF_JMP_CMD
+
+constexpr int    MNEMONIC_NUM        = sizeof(MNEMONICS) / sizeof(mnemonic);
+constexpr int    MNEMONIC_TABLE_BITS = 6;
+constexpr int    MNEMONIC_TABLE_SIZE = 1 << MNEMONIC_TABLE_BITS;
+
+static_assert(MNEMONIC_NUM <= MNEMONIC_TABLE_SIZE, "too many commands in cmd.h for the table of mnemonics");
+
+constexpr char mnemonic_lower(const char sym)
+{
+    return (sym >= 'A' && sym <= 'Z') ? (char) (sym - 'A' + 'a') : sym;
+}
+
+constexpr size_t mnemonic_min_len()
+{
+    size_t len = MNEMONICS[0].len;
+    for (int cnt = 1; cnt < MNEMONIC_NUM; ++cnt) if (MNEMONICS[cnt].len < len) len = MNEMONICS[cnt].len;
+    return len;
+}
+
+constexpr size_t mnemonic_max_len()
+{
+    size_t len = MNEMONICS[0].len;
+    for (int cnt = 1; cnt < MNEMONIC_NUM; ++cnt) if (MNEMONICS[cnt].len > len) len = MNEMONICS[cnt].len;
+    return len;
+}
+
+constexpr size_t MNEMONIC_MIN_LEN = mnemonic_min_len();
+constexpr size_t MNEMONIC_MAX_LEN = mnemonic_max_len();
+
+static_assert(MNEMONIC_MIN_LEN >= 2, "names of commands must have at least two characters");
+
+/**
+*   @brief Gets the slot of the name "ptr" of "len" (at least MNEMONIC_MIN_LEN) characters.
+*/
+
+constexpr unsigned mnemonic_hash(const char *ptr, const size_t len, const unsigned seed)
+{
+    unsigned key = (unsigned) (unsigned char) mnemonic_lower(ptr[0])
+                 | (unsigned) (unsigned char) mnemonic_lower(ptr[1])       <<  8
+                 | (unsigned) (unsigned char) mnemonic_lower(ptr[len - 1]) << 16
+                 | (unsigned) len                                          << 24;
+
+    return (key * seed) >> (32 - MNEMONIC_TABLE_BITS);
+}
+
+constexpr bool mnemonic_is_perfect(const unsigned seed)
+{
+    bool is_used[MNEMONIC_TABLE_SIZE] = {};
+
+    for (int cnt = 0; cnt < MNEMONIC_NUM; ++cnt)
+    {
+        unsigned slot = mnemonic_hash(MNEMONICS[cnt].name, MNEMONICS[cnt].len, seed);
+
+        if (is_used[slot]) return false;
+        is_used[slot] = true;
+    }
+    return true;
+}
+
+constexpr unsigned mnemonic_find_seed()
+{
+    for (unsigned seed = 2654435761u; seed < 2654435761u + 2 * 100000; seed += 2)
+    {
+        if (mnemonic_is_perfect(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr unsigned MNEMONIC_SEED = mnemonic_find_seed();
+
+static_assert(MNEMONIC_SEED != 0, "there is no perfect hash for commands from cmd.h, change the key of mnemonic_hash()");
+
+struct mnemonic_table
+{
+    signed char slots[MNEMONIC_TABLE_SIZE]; // index in MNEMONICS, -1 - empty slot
+};
+
+constexpr mnemonic_table mnemonic_make_table()
+{
+    mnemonic_table table = {};
+
+    for (int cnt = 0; cnt < MNEMONIC_TABLE_SIZE; ++cnt) table.slots[cnt] = -1;
+    for (int cnt = 0; cnt < MNEMONIC_NUM;        ++cnt) table.slots[mnemonic_hash(MNEMONICS[cnt].name, MNEMONICS[cnt].len, MNEMONIC_SEED)] = (signed char) cnt;
+
+    return table;
+}
+
+constexpr mnemonic_table MNEMONIC_TABLE = mnemonic_make_table();
+
+/**
+*   @brief Identifies the command name "ptr" of "len" characters (case-insensitive).
+*
+*   @return the value from enum "CMD" or CMD_NOT_EXICTING if it is not a command
+*/
+
+inline CMD mnemonic_find(const char *ptr, const size_t len)
+{
+    if (len < MNEMONIC_MIN_LEN || len > MNEMONIC_MAX_LEN) return CMD_NOT_EXICTING;
+
+    int index = MNEMONIC_TABLE.slots[mnemonic_hash(ptr, len, MNEMONIC_SEED)];
+    if (index == -1 || MNEMONICS[index].len != len) return CMD_NOT_EXICTING;
+
+    for (size_t sym = 0; sym < len; ++sym)
+    {
+        if (mnemonic_lower(ptr[sym]) != mnemonic_lower(MNEMONICS[index].name[sym])) return CMD_NOT_EXICTING;
+    }
+    return MNEMONICS[index].cmd;
+}
+
+#endif //MNEMONIC_H
@@ -0,0 +1,1278 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "cpu.h"
+#include "optimize.h"
+
+const int JMP_CHAIN_MAX   = 64; // jumps followed from one jump, so cycles of "jmp" are not followed infinitely
+const int INLINE_MAX_SIZE = 32; // instructions of the routine with its RET which can be inlined
+const int OPT_ROUND_MAX   =  8; // rounds of the data-flow and peephole optimizers in "optimize_program()"
+
+const unsigned ALL_REGS = ((1u << (REG_NUM + 1)) - 1) & ~1u;  // bit i is register i
+
+/*
+ * Output of one pass of the peephole optimizer. Instructions are moved to the beginning of "program->cmds",
+ * the last ones are compared with patterns and replaced.
+ */
+
+struct peephole
+{
+    decoded *program;
+
+    int  size;          // number of moved instructions
+    bool *is_entry;     // is_entry[i] - the instruction i of the input can be reached not only from the previous one
+    bool *out_entry;    // the same for the moved instructions
+    bool  is_pending;   // the entry is removed, so the next moved instruction becomes an entry
+
+    int *new_index;     // new_index[i] - index of the instruction i of the input among moved ones
+};
+
+/*
+ * Routine called by CALL. Its body is the instructions from "target" up to the first RET.
+ */
+
+struct routine
+{
+    int target;
+    int ret;            // index of RET, -1 if the routine can't be inlined
+
+    int *callees;       // routines called from the body
+    int  callee_num;
+
+    int  visit;         // mark of the search of recursion
+};
+
+struct call_site
+{
+    int site;           // index of CALL
+    int routine;
+    int cost;           // instructions added by inlining
+};
+
+enum VAL_KIND
+{
+    VAL_UNDEF  ,    // nothing reaches the point yet
+    VAL_CONST  ,
+    VAL_UNKNOWN
+};
+
+struct flow_val
+{
+    VAL_KIND kind;
+    stack_el val;
+};
+
+/*
+ * Basic block of the data-flow optimizer: instructions from "begin" up to "end" (not included),
+ * only the first one can be reached by a jump, only the last one can jump.
+ */
+
+struct flow_block
+{
+    int begin;
+    int end;
+
+    int succ[2];                    // successor blocks, -1 if there is no successor
+    bool is_reached;
+    bool in_worklist;
+
+    flow_val regs[REG_NUM + 1];     // values of registers at the beginning of the block
+    unsigned live_in;               // registers which can be read before they are written from the beginning of the block
+};
+
+struct flow_graph
+{
+    decoded *program;
+
+    flow_block *blocks;
+    int         block_num;
+    int        *block_of;           // block_of[i] - block of the instruction i, the end of the program leads to the block 0
+
+    flow_val *stk;                  // values on the top of the stack inside a block, values below them are unknown
+    int       stk_size;
+
+    int *worklist;
+    int  worklist_size;
+};
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static bool     peephole_pass   (decoded *const program, int *const cmd_map, const int map_size, opt_report *const report);
+static int      retarget_chains (decoded *const program);
+static void     mark_entries    (const decoded *const program, bool *const is_entry);
+static bool     reduce_tail     (peephole *ph, const int cmd_cnt, opt_report *const report);
+static void     shrink_tail     (peephole *ph, const int cmd_cnt, const int new_size, const int map_to);
+static bool     fold_cmd        (const instruction *cur, const stack_el a, const stack_el b, stack_el *const val);
+static int      follow_jmp      (const decoded *const program, int target);
+static void     scan_routine    (const decoded *const program, routine *const rt, const int *routine_of, opt_inline *const decision);
+static bool     is_recursive    (routine *const routines, const int rt_cnt, const int start, const int visit);
+static void     copy_inlined    (const decoded *const program, const routine *rt, const int site, const int *new_index, instruction *const copy);
+static int      cmp_call_sites  (const void *fst, const void *sec);
+static bool     fold_jcc        (const instruction *cur, const stack_el a, const stack_el b);
+static void     build_flow      (flow_graph *fg, decoded *const program);
+static void     flow_dtor       (flow_graph *fg);
+static void     add_succ        (flow_graph *fg, flow_block *blk, const int cmd_cnt);
+static void     merge_regs      (flow_graph *fg, const int blk_cnt, const flow_val *regs);
+static void     pass_block      (flow_graph *fg, const int blk_cnt, flow_val *const regs, opt_report *const report);
+static void     pass_cmd        (flow_graph *fg, instruction *const cur, flow_val *const regs, opt_report *const report);
+static bool     const_reg       (instruction *const cur, const flow_val *regs);
+static void     stk_push        (flow_graph *fg, const flow_val val);
+static flow_val stk_pop         (flow_graph *fg);
+static void     find_live       (flow_graph *fg);
+static unsigned live_cmd        (instruction *const cur, unsigned live, opt_report *const report);
+static unsigned live_out        (const flow_graph *fg, const flow_block *blk);
+static int      drop_unreached  (flow_graph *fg, int *const cmd_map, const int map_size);
+static bool     is_jmp          (const unsigned char handler);
+static bool     is_num_push     (const instruction *cur);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Replaces patterns of instructions by shorter ones until there is nothing to replace:
+*   @brief - "push a / push b / add" (sub, mul, div) by "push (a + b)", division by zero is not folded;
+*   @brief - "push ... / pop" without memory arguments by nothing;
+*   @brief - "jmp" to the next instruction by nothing;
+*   @brief - jump to "jmp L" by jump to "L".
+*   @brief Instructions which can be reached by a jump or by RET are not merged with the previous ones.
+*
+*   @param program  [in][out] - decoded program
+*   @param cmd_map  [in][out] - indices of instructions, they become indices in the optimized program:
+*                               an instruction replaced with others maps to the replacement, a removed one maps to the next instruction
+*   @param map_size [in]      - number of indices in "cmd_map"
+*   @param report   [out]     - numbers of applied replacements are added to it
+*
+*   @return true if the program is changed and false else
+*/
+
+bool optimize_peephole(decoded *const program, int *const cmd_map, const int map_size, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    bool is_changed = false;
+
+    while (peephole_pass(program, cmd_map, map_size, report)) is_changed = true;
+
+    return is_changed;
+}
+
+/**
+*   @brief Replaces CALL by JMP if the next executed instruction after the return is RET ("tail call"):
+*   @brief RET after the called function returns to the same point as the RET after CALL,
+*   @brief so the point of CALL is not pushed to the stack of return points at all. RET after CALL can be reached through "jmp".
+*   @brief Indices of instructions are not changed.
+*
+*   @param program [in][out] - decoded program
+*   @param report  [out]     - number of replaced calls is added to it
+*
+*   @return true if the program is changed and false else
+*/
+
+bool optimize_tail_calls(decoded *const program, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    int tail_num = 0;
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (cur->handler != CMD_CALL) continue;
+
+        int ret_point = follow_jmp(program, cmd_cnt + 1);
+        if (program->cmds[ret_point].handler != CMD_RET) continue;
+
+        cur->cmd     = CMD_JMP;
+        cur->handler = CMD_JMP;
+        ++tail_num;
+    }
+
+    report->tail_calls += tail_num;
+    return tail_num != 0;
+}
+
+/**
+*   @brief Replaces CALL by the copy of the called routine ("inlining"). The routine is inlined if:
+*   @brief its body up to the first RET is not longer than INLINE_MAX_SIZE instructions, jumps of the body don't leave it
+*   @brief (jumps to its RET become jumps to the instruction after CALL), it doesn't call itself through the routines which can be inlined.
+*   @brief The cheapest calls are inlined first while the number of added instructions is not more than "budget".
+*   @brief Decisions about every routine are put in "report->inlines".
+*
+*   @param program  [in][out] - decoded program
+*   @param cmd_map  [in][out] - indices of instructions, they become indices in the program after inlining
+*   @param map_size [in]      - number of indices in "cmd_map"
+*   @param budget   [in]      - maximal number of instructions which can be added
+*   @param report   [out]     - the number of added instructions and decisions are put in it
+*
+*   @return true if the program is changed and false else
+*/
+
+bool optimize_inline(decoded *const program, int *const cmd_map, const int map_size, const int budget, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    int cmd_num = program->size;
+
+    int       *routine_of = (int *)       calloc(cmd_num + 1, sizeof(int));
+    routine   *routines   = (routine *)   calloc(cmd_num + 1, sizeof(routine));
+    call_site *sites      = (call_site *) calloc(cmd_num + 1, sizeof(call_site));
+    assert(routine_of != nullptr);
+    assert(routines   != nullptr);
+    assert(sites      != nullptr);
+
+    int routine_num = 0;
+    int site_num    = 0;
+
+    for (int cmd_cnt = 0; cmd_cnt <= cmd_num; ++cmd_cnt) routine_of[cmd_cnt] = -1;
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (cur->handler != CMD_CALL || routine_of[cur->jmp] != -1) continue;
+
+        routine_of[cur->jmp]           = routine_num;
+        routines  [routine_num].target = cur->jmp;
+        ++routine_num;
+    }
+
+    free(report->inlines);
+    report->inline_num = routine_num;
+    report->inlines    = (opt_inline *) calloc(routine_num + 1, sizeof(opt_inline));
+    assert(report->inlines != nullptr);
+
+    for (int rt_cnt = 0; rt_cnt < routine_num; ++rt_cnt)
+    {
+        report->inlines[rt_cnt].target = routines[rt_cnt].target;
+        scan_routine(program, routines + rt_cnt, routine_of, report->inlines + rt_cnt);
+    }
+
+    for (int rt_cnt = 0; rt_cnt < routine_num; ++rt_cnt)
+    {
+        if (routines[rt_cnt].ret != -1 && is_recursive(routines, rt_cnt, rt_cnt, rt_cnt + 1)) report->inlines[rt_cnt].reason = "recursive";
+    }
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (cur->handler != CMD_CALL) continue;
+
+        int rt_cnt = routine_of[cur->jmp];
+        ++report->inlines[rt_cnt].call_num;
+
+        if (report->inlines[rt_cnt].reason != nullptr) continue;
+
+        sites[site_num++] = {cmd_cnt, rt_cnt, routines[rt_cnt].ret - routines[rt_cnt].target - 1};
+    }
+
+    qsort(sites, site_num, sizeof(call_site), cmp_call_sites);
+
+    int *inlined = (int *) calloc(cmd_num + 1, sizeof(int));   // inlined[i] - routine inlined instead of CALL i or -1
+    assert(inlined != nullptr);
+
+    for (int cmd_cnt = 0; cmd_cnt <= cmd_num; ++cmd_cnt) inlined[cmd_cnt] = -1;
+
+    int added       = 0;
+    int inlined_num = 0;
+    for (int site_cnt = 0; site_cnt < site_num; ++site_cnt)
+    {
+        const call_site *cur = sites + site_cnt;
+
+        if (added + cur->cost > budget)
+        {
+            report->inlines[cur->routine].reason = "the size budget is spent";
+            continue;
+        }
+
+        added += cur->cost;
+        ++inlined_num;
+        inlined[cur->site] = cur->routine;
+        ++report->inlines[cur->routine].inlined_num;
+    }
+
+    if (inlined_num != 0)
+    {
+        int *new_index = (int *) calloc(cmd_num + 1, sizeof(int));
+        assert(new_index != nullptr);
+
+        int new_num = 0;
+        for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+        {
+            new_index[cmd_cnt] = new_num;
+            new_num += (inlined[cmd_cnt] == -1) ? 1 : routines[inlined[cmd_cnt]].ret - routines[inlined[cmd_cnt]].target;
+        }
+        new_index[cmd_num] = new_num;
+
+        instruction *cmds = (instruction *) calloc(new_num + 1, sizeof(instruction));
+        assert(cmds != nullptr);
+
+        for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+        {
+            if (inlined[cmd_cnt] != -1)
+            {
+                copy_inlined(program, routines + inlined[cmd_cnt], cmd_cnt, new_index, cmds + new_index[cmd_cnt]);
+                continue;
+            }
+
+            cmds[new_index[cmd_cnt]] = program->cmds[cmd_cnt];
+            if (is_jmp(program->cmds[cmd_cnt].handler)) cmds[new_index[cmd_cnt]].jmp = new_index[program->cmds[cmd_cnt].jmp];
+        }
+        cmds[new_num] = {CMD_NOT_EXICTING, CMD_NOT_EXICTING, 0, 0, 0, nullptr};
+
+        for (int map_cnt = 0; cmd_map != nullptr && map_cnt < map_size; ++map_cnt) cmd_map[map_cnt] = new_index[cmd_map[map_cnt]];
+
+        free(program->cmds);
+        program->cmds = cmds;
+        program->size = new_num;
+
+        free(new_index);
+    }
+
+    report->inline_added += added;
+
+    for (int rt_cnt = 0; rt_cnt < routine_num; ++rt_cnt) free(routines[rt_cnt].callees);
+    free(routines);
+    free(routine_of);
+    free(sites);
+    free(inlined);
+
+    return inlined_num != 0;
+}
+
+void opt_report_dtor(opt_report *const report)
+{
+    assert(report != nullptr);
+
+    free(report->inlines);
+    *report = {};
+}
+
+/**
+*   @brief Optimizes the program by all the passes: inlining, tail calls, then the data-flow and peephole optimizers by turns
+*   @brief while they change the program (up to OPT_ROUND_MAX rounds).
+*
+*   @param program       [in][out] - decoded program
+*   @param cmd_map       [in][out] - indices of instructions, they become indices in the optimized program, can be nullptr
+*   @param map_size      [in]      - number of indices in "cmd_map"
+*   @param inline_budget [in]      - maximal number of instructions which can be added by inlining
+*   @param report        [out]     - report of the passes
+*/
+
+void optimize_program(decoded *const program, int *const cmd_map, const int map_size, const int inline_budget, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    report->cmd_num = program->size;
+
+    optimize_inline    (program, cmd_map, map_size, inline_budget, report);
+    optimize_tail_calls(program, report);
+
+    bool is_changed = true;
+    for (int round_cnt = 0; is_changed && round_cnt < OPT_ROUND_MAX; ++round_cnt)
+    {
+        is_changed  = optimize_dataflow(program, cmd_map, map_size, report);
+        is_changed |= optimize_peephole(program, cmd_map, map_size, report);
+    }
+}
+
+/**
+*   @brief Optimizes the program using its control flow graph of basic blocks:
+*   @brief - constant propagation: values of registers are followed through the blocks (inside a block values on the stack are followed too),
+*   @brief   a register which is a known constant is replaced by the constant in "push" and in memory arguments;
+*   @brief - dead stores: "pop reg" is replaced by "pop void" if the register is not read before it is written again;
+*   @brief - unreachable code: blocks which can't be reached from the beginning are removed.
+*   @brief Registers are unknown at the beginning (the program is executed again while the window is opened) and after CALL.
+*   @brief A called routine and RET are considered to read all the registers.
+*
+*   @param program  [in][out] - decoded program
+*   @param cmd_map  [in][out] - indices of instructions, they become indices in the optimized program, can be nullptr
+*   @param map_size [in]      - number of indices in "cmd_map"
+*   @param report   [out]     - numbers of replaced and removed instructions are added to it
+*
+*   @return true if the program is changed and false else
+*/
+
+bool optimize_dataflow(decoded *const program, int *const cmd_map, const int map_size, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    if (program->size == 0) return false;
+
+    opt_report before = *report;
+
+    flow_graph fg = {};
+    build_flow(&fg, program);
+
+    flow_val regs[REG_NUM + 1] = {};
+
+    while (fg.worklist_size > 0)
+    {
+        int blk_cnt = fg.worklist[--fg.worklist_size];
+        fg.blocks[blk_cnt].in_worklist = false;
+
+        memcpy(regs, fg.blocks[blk_cnt].regs, sizeof(regs));
+        pass_block(&fg, blk_cnt, regs, nullptr);
+    }
+
+    for (int blk_cnt = 0; blk_cnt < fg.block_num; ++blk_cnt)
+    {
+        if (!fg.blocks[blk_cnt].is_reached) continue;
+
+        memcpy(regs, fg.blocks[blk_cnt].regs, sizeof(regs));
+        pass_block(&fg, blk_cnt, regs, report);
+    }
+
+    find_live(&fg);
+
+    for (int blk_cnt = 0; blk_cnt < fg.block_num; ++blk_cnt)
+    {
+        const flow_block *blk  = fg.blocks + blk_cnt;
+        unsigned          live = live_out(&fg, blk);
+
+        if (!blk->is_reached) continue;
+
+        for (int cmd_cnt = blk->end - 1; cmd_cnt >= blk->begin; --cmd_cnt) live = live_cmd(program->cmds + cmd_cnt, live, report);
+    }
+
+    report->unreachable += drop_unreached(&fg, cmd_map, map_size);
+
+    flow_dtor(&fg);
+
+    return report->const_regs  != before.const_regs ||
+           report->dead_pops   != before.dead_pops  ||
+           report->unreachable != before.unreachable;
+}
+
+/**
+*   @brief Retargets jump chains and replaces patterns once.
+*
+*   @return true if the program is changed and false else
+*/
+
+static bool peephole_pass(decoded *const program, int *const cmd_map, const int map_size, opt_report *const report)
+{
+    assert(program != nullptr);
+    assert(report  != nullptr);
+
+    int chain_num = retarget_chains(program);
+    report->jmp_chains += chain_num;
+
+    int cmd_num = program->size;
+
+    peephole ph  = {};
+    ph.program   = program;
+    ph.is_entry  = (bool *) calloc(cmd_num + 1, sizeof(bool));
+    ph.out_entry = (bool *) calloc(cmd_num + 1, sizeof(bool));
+    ph.new_index = (int  *) calloc(cmd_num + 1, sizeof(int));
+
+    assert(ph.is_entry  != nullptr);
+    assert(ph.out_entry != nullptr);
+    assert(ph.new_index != nullptr);
+
+    mark_entries(program, ph.is_entry);
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        ph.new_index[cmd_cnt] = ph.size;
+
+        program->cmds[ph.size] = program->cmds[cmd_cnt];
+        ph.out_entry [ph.size] = ph.is_entry[cmd_cnt] || ph.is_pending;
+        ph.is_pending          = false;
+        ++ph.size;
+
+        while (reduce_tail(&ph, cmd_cnt, report)) {}
+    }
+    ph.new_index[cmd_num] = ph.size;
+
+    program->size = ph.size;
+    program->cmds[ph.size] = {CMD_NOT_EXICTING, CMD_NOT_EXICTING, 0, 0, 0, nullptr};
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (is_jmp(cur->handler)) cur->jmp = ph.new_index[cur->jmp];
+    }
+
+    for (int map_cnt = 0; cmd_map != nullptr && map_cnt < map_size; ++map_cnt) cmd_map[map_cnt] = ph.new_index[cmd_map[map_cnt]];
+
+    free(ph.is_entry);
+    free(ph.out_entry);
+    free(ph.new_index);
+
+    return chain_num != 0 || program->size != cmd_num;
+}
+
+/**
+*   @brief Retargets every jump and CALL to "jmp L" to "L". Chains of "jmp" are followed up to JMP_CHAIN_MAX jumps.
+*
+*   @return number of retargeted jumps
+*/
+
+static int retarget_chains(decoded *const program)
+{
+    assert(program != nullptr);
+
+    int chain_num = 0;
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (!is_jmp(cur->handler)) continue;
+
+        int target = follow_jmp(program, cur->jmp);
+        if (target != cur->jmp)
+        {
+            cur->jmp = target;
+            ++chain_num;
+        }
+    }
+
+    return chain_num;
+}
+
+/**
+*   @brief Marks instructions which can be reached not only from the previous one:
+*   @brief the first one (the program is executed again from the beginning), targets of jumps and instructions after CALL.
+*/
+
+static void mark_entries(const decoded *const program, bool *const is_entry)
+{
+    assert(program  != nullptr);
+    assert(is_entry != nullptr);
+
+    is_entry[0] = true;
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (!is_jmp(cur->handler)) continue;
+
+        is_entry[cur->jmp] = true;
+        if (cur->handler == CMD_CALL) is_entry[cmd_cnt + 1] = true;
+    }
+}
+
+/**
+*   @brief Replaces the last moved instructions if they match one of the patterns.
+*
+*   @param ph      [in][out] - output of the pass
+*   @param cmd_cnt [in]      - index of the last moved instruction in the input
+*   @param report  [out]     - numbers of applied replacements are added to it
+*
+*   @return true if the instructions are replaced and false else
+*/
+
+static bool reduce_tail(peephole *ph, const int cmd_cnt, opt_report *const report)
+{
+    assert(ph     != nullptr);
+    assert(report != nullptr);
+
+    instruction *cmds = ph->program->cmds;
+    int          size = ph->size;
+
+    if (size == 0) return false;
+
+    const instruction *last = cmds + size - 1;
+
+    if (last->handler == CMD_JMP && last->jmp == cmd_cnt + 1)
+    {
+        ph->is_pending = ph->is_pending || ph->out_entry[size - 1];
+        shrink_tail(ph, cmd_cnt, size - 1, size - 1);
+
+        ++report->jmp_next;
+        return true;
+    }
+
+    if (size < 2 || ph->out_entry[size - 1]) return false;
+
+    const instruction *prev = cmds + size - 2;
+
+    if (last->cmd == (CMD_POP | CMD_NUM_ARG) && prev->handler == CMD_PUSH && !(prev->cmd & CMD_MEM_ARG))
+    {
+        ph->is_pending = ph->is_pending || ph->out_entry[size - 2];
+        shrink_tail(ph, cmd_cnt, size - 2, size - 2);
+
+        ++report->push_pop;
+        return true;
+    }
+
+    if (size < 3 || ph->out_entry[size - 2] || ph->is_pending) return false;
+
+    instruction *first = cmds + size - 3;
+    stack_el     val   = 0;
+
+    if (is_num_push(first) && is_num_push(prev) && fold_cmd(last, prev->val, first->val, &val))
+    {
+        first->val = val;
+        shrink_tail(ph, cmd_cnt, size - 2, size - 3);
+
+        ++report->folded;
+        return true;
+    }
+
+    if (is_num_push(first) && is_num_push(prev) && last->handler >= CMD_JA && last->handler <= CMD_JNE)
+    {
+        if (fold_jcc(last, prev->val, first->val))
+        {
+            *first = {CMD_JMP, CMD_JMP, 0, last->jmp, 0, nullptr};
+            shrink_tail(ph, cmd_cnt, size - 2, size - 3);
+        }
+        else
+        {
+            ph->is_pending = ph->is_pending || ph->out_entry[size - 3];
+            shrink_tail(ph, cmd_cnt, size - 3, size - 3);
+        }
+
+        ++report->jcc_folded;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+*   @brief Removes the last moved instructions. Input instructions which are moved to the removed ones are mapped to "map_to".
+*
+*   @param ph       [in][out] - output of the pass
+*   @param cmd_cnt  [in]      - index of the last moved instruction in the input
+*   @param new_size [in]      - number of moved instructions which are left
+*   @param map_to   [in]      - index among moved instructions
+*/
+
+static void shrink_tail(peephole *ph, const int cmd_cnt, const int new_size, const int map_to)
+{
+    assert(ph != nullptr);
+
+    for (int map_cnt = cmd_cnt; map_cnt >= 0 && ph->new_index[map_cnt] > map_to; --map_cnt) ph->new_index[map_cnt] = map_to;
+
+    ph->size = new_size;
+}
+
+/**
+*   @brief Counts the result of the arithmetic command the same way as "cmd.h" does: "b" is pushed before "a".
+*
+*   @return false if "cur" is not ADD, SUB, MUL or DIV or it divides by zero and true else
+*/
+
+static bool fold_cmd(const instruction *cur, const stack_el a, const stack_el b, stack_el *const val)
+{
+    assert(cur != nullptr);
+    assert(val != nullptr);
+
+    switch (cur->cmd)
+    {
+        case CMD_ADD: *val = a + b; return true;
+        case CMD_SUB: *val = b - a; return true;
+        case CMD_MUL: *val = a * b; return true;
+
+        case CMD_DIV:
+            if (a == 0) return false;
+
+            *val = b / a;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+*   @brief Finds the body of the routine and checks if it can be inlined. Puts the reason in "decision" if it can't.
+*/
+
+static void scan_routine(const decoded *const program, routine *const rt, const int *routine_of, opt_inline *const decision)
+{
+    assert(program    != nullptr);
+    assert(rt         != nullptr);
+    assert(routine_of != nullptr);
+    assert(decision   != nullptr);
+
+    rt->ret = -1;
+
+    int ret = rt->target;
+    while (ret < program->size && ret - rt->target < INLINE_MAX_SIZE && program->cmds[ret].handler != CMD_RET) ++ret;
+
+    if (ret == program->size || program->cmds[ret].handler != CMD_RET)
+    {
+        decision->reason = (ret == program->size) ? "there is no \"ret\" after it" : "it is too long";
+        return;
+    }
+    decision->size = ret - rt->target + 1;
+
+    for (int cmd_cnt = rt->target; cmd_cnt < ret; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (!is_jmp(cur->handler)) continue;
+
+        if (cur->handler == CMD_CALL)
+        {
+            if (rt->callees == nullptr) rt->callees = (int *) calloc(INLINE_MAX_SIZE, sizeof(int));
+            assert(rt->callees != nullptr);
+
+            rt->callees[rt->callee_num++] = routine_of[cur->jmp];
+        }
+        else if (cur->jmp < rt->target || cur->jmp > ret)
+        {
+            decision->reason = "it jumps out of its body";
+            return;
+        }
+    }
+
+    rt->ret = ret;
+}
+
+/**
+*   @brief Searches the routine "start" among the routines called by "rt_cnt" which can be inlined (depth-first search).
+*
+*   @param visit [in] - mark of this search, routines marked by it are not visited again
+*/
+
+static bool is_recursive(routine *const routines, const int rt_cnt, const int start, const int visit)
+{
+    assert(routines != nullptr);
+
+    routine *rt = routines + rt_cnt;
+    rt->visit = visit;
+
+    for (int callee_cnt = 0; callee_cnt < rt->callee_num; ++callee_cnt)
+    {
+        int callee = rt->callees[callee_cnt];
+
+        if (callee == start) return true;
+        if (routines[callee].ret == -1 || routines[callee].visit == visit) continue;
+
+        if (is_recursive(routines, callee, start, visit)) return true;
+    }
+
+    return false;
+}
+
+/**
+*   @brief Copies the body of the routine without its RET instead of CALL. Jumps inside the body lead to the copies,
+*   @brief jumps to RET lead to the instruction after CALL.
+*
+*   @param program   [in]  - decoded program
+*   @param rt        [in]  - inlined routine
+*   @param site      [in]  - index of CALL
+*   @param new_index [in]  - indices of the instructions after inlining
+*   @param copy      [out] - place of the copy
+*/
+
+static void copy_inlined(const decoded *const program, const routine *rt, const int site, const int *new_index, instruction *const copy)
+{
+    assert(program   != nullptr);
+    assert(rt        != nullptr);
+    assert(new_index != nullptr);
+    assert(copy      != nullptr);
+
+    for (int cmd_cnt = rt->target; cmd_cnt < rt->ret; ++cmd_cnt)
+    {
+        instruction *cur = copy + cmd_cnt - rt->target;
+        *cur = program->cmds[cmd_cnt];
+
+        if      (cur->handler == CMD_CALL) cur->jmp = new_index[cur->jmp];
+        else if (is_jmp(cur->handler))     cur->jmp = (cur->jmp == rt->ret) ? new_index[site + 1] : new_index[site] + cur->jmp - rt->target;
+    }
+}
+
+/**
+*   @brief Compares call sites by the cost of inlining, then by the index of CALL (for "qsort()").
+*/
+
+static int cmp_call_sites(const void *fst, const void *sec)
+{
+    const call_site *fst_site = (const call_site *) fst;
+    const call_site *sec_site = (const call_site *) sec;
+
+    if (fst_site->cost != sec_site->cost) return fst_site->cost - sec_site->cost;
+    return fst_site->site - sec_site->site;
+}
+
+/**
+*   @brief Compares the values of the conditional jump the same way as "approx_cmp()" does: "b" is pushed before "a".
+*
+*   @return true if the jump is taken and false else
+*/
+
+static bool fold_jcc(const instruction *cur, const stack_el a, const stack_el b)
+{
+    assert(cur != nullptr);
+
+    bool is_equal = fabs((double) b - (double) a) < DELTA;
+
+    switch (cur->handler)
+    {
+        case CMD_JA : return !is_equal && b > a;
+        case CMD_JAE: return  is_equal || b > a;
+        case CMD_JB : return !is_equal && b < a;
+        case CMD_JBE: return  is_equal || b < a;
+        case CMD_JE : return  is_equal;
+        case CMD_JNE: return !is_equal;
+
+        default:
+            return false;
+    }
+}
+
+/**
+*   @brief Splits the program in basic blocks and finds their successors.
+*   @brief Puts the first block and blocks after CALL in the worklist of the constant propagation.
+*/
+
+static void build_flow(flow_graph *fg, decoded *const program)
+{
+    assert(fg      != nullptr);
+    assert(program != nullptr);
+
+    int cmd_num = program->size;
+
+    bool *is_leader = (bool *) calloc(cmd_num + 1, sizeof(bool));
+    assert(is_leader != nullptr);
+
+    is_leader[0] = true;
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+
+        if (is_jmp(cur->handler)) is_leader[cur->jmp] = true;
+        if (is_jmp(cur->handler) || cur->handler == CMD_RET || cur->handler == CMD_HLT) is_leader[cmd_cnt + 1] = true;
+    }
+
+    *fg = {};
+    fg->program  = program;
+    fg->blocks   = (flow_block *) calloc(cmd_num + 1, sizeof(flow_block));
+    fg->block_of = (int *)        calloc(cmd_num + 1, sizeof(int));
+    fg->stk      = (flow_val *)   calloc(cmd_num + 1, sizeof(flow_val));
+    fg->worklist = (int *)        calloc(cmd_num + 1, sizeof(int));
+
+    assert(fg->blocks   != nullptr);
+    assert(fg->block_of != nullptr);
+    assert(fg->stk      != nullptr);
+    assert(fg->worklist != nullptr);
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        if (is_leader[cmd_cnt])
+        {
+            if (fg->block_num > 0) fg->blocks[fg->block_num - 1].end = cmd_cnt;
+            fg->blocks[fg->block_num++].begin = cmd_cnt;
+        }
+        fg->block_of[cmd_cnt] = fg->block_num - 1;
+    }
+    fg->blocks[fg->block_num - 1].end = cmd_num;
+    fg->block_of[cmd_num] = 0;
+
+    flow_val unknown[REG_NUM + 1] = {};
+    for (int reg_cnt = 1; reg_cnt <= REG_NUM; ++reg_cnt) unknown[reg_cnt].kind = VAL_UNKNOWN;
+
+    for (int blk_cnt = 0; blk_cnt < fg->block_num; ++blk_cnt)
+    {
+        flow_block        *blk  = fg->blocks + blk_cnt;
+        const instruction *last = program->cmds + blk->end - 1;
+
+        blk->succ[0] = blk->succ[1] = -1;
+
+        if (is_jmp(last->handler)) add_succ(fg, blk, last->jmp);
+        if (last->handler != CMD_JMP && last->handler != CMD_RET && last->handler != CMD_HLT) add_succ(fg, blk, blk->end);
+
+        if (blk_cnt == 0 || (blk->begin > 0 && program->cmds[blk->begin - 1].handler == CMD_CALL))
+        {
+            memcpy(blk->regs, unknown, sizeof(unknown));
+        }
+    }
+
+    merge_regs(fg, 0, unknown);
+
+    free(is_leader);
+}
+
+static void flow_dtor(flow_graph *fg)
+{
+    assert(fg != nullptr);
+
+    free(fg->blocks);
+    free(fg->block_of);
+    free(fg->stk);
+    free(fg->worklist);
+
+    *fg = {};
+}
+
+static void add_succ(flow_graph *fg, flow_block *blk, const int cmd_cnt)
+{
+    assert(fg  != nullptr);
+    assert(blk != nullptr);
+
+    int succ = fg->block_of[cmd_cnt];
+
+    if      (blk->succ[0] == -1)   blk->succ[0] = succ;
+    else if (blk->succ[0] != succ) blk->succ[1] = succ;
+}
+
+/**
+*   @brief Merges values of registers at the end of a predecessor with values at the beginning of the block.
+*   @brief Puts the block in the worklist if the values are changed or the block is reached for the first time.
+*/
+
+static void merge_regs(flow_graph *fg, const int blk_cnt, const flow_val *regs)
+{
+    assert(fg   != nullptr);
+    assert(regs != nullptr);
+
+    flow_block *blk        = fg->blocks + blk_cnt;
+    bool        is_changed = !blk->is_reached;
+
+    blk->is_reached = true;
+
+    for (int reg_cnt = 1; reg_cnt <= REG_NUM; ++reg_cnt)
+    {
+        flow_val       *dst = blk->regs + reg_cnt;
+        const flow_val *src = regs      + reg_cnt;
+
+        if (src->kind == VAL_UNDEF || dst->kind == VAL_UNKNOWN) continue;
+
+        if (dst->kind == VAL_UNDEF) *dst = *src;
+        else if (src->kind == VAL_UNKNOWN || src->val != dst->val) dst->kind = VAL_UNKNOWN;
+        else continue;
+
+        is_changed = true;
+    }
+
+    if (is_changed && !blk->in_worklist)
+    {
+        blk->in_worklist = true;
+        fg->worklist[fg->worklist_size++] = blk_cnt;
+    }
+}
+
+/**
+*   @brief Passes values of registers through the block and merges them with its successors.
+*
+*   @param fg      [in][out] - control flow graph
+*   @param blk_cnt [in]      - index of the block
+*   @param regs    [in][out] - values of registers at the beginning of the block, they become values at the end
+*   @param report  [out]     - if it is not nullptr, registers which are known constants are replaced and counted in it
+*/
+
+static void pass_block(flow_graph *fg, const int blk_cnt, flow_val *const regs, opt_report *const report)
+{
+    assert(fg   != nullptr);
+    assert(regs != nullptr);
+
+    const flow_block *blk = fg->blocks + blk_cnt;
+
+    fg->stk_size = 0;
+
+    for (int cmd_cnt = blk->begin; cmd_cnt < blk->end; ++cmd_cnt) pass_cmd(fg, fg->program->cmds + cmd_cnt, regs, report);
+
+    if (report != nullptr) return;
+
+    for (int succ_cnt = 0; succ_cnt < 2; ++succ_cnt)
+    {
+        if (blk->succ[succ_cnt] != -1) merge_regs(fg, blk->succ[succ_cnt], regs);
+    }
+}
+
+/**
+*   @brief Passes values of registers and of the stack through the instruction.
+*/
+
+static void pass_cmd(flow_graph *fg, instruction *const cur, flow_val *const regs, opt_report *const report)
+{
+    assert(fg   != nullptr);
+    assert(cur  != nullptr);
+    assert(regs != nullptr);
+
+    if (report != nullptr && const_reg(cur, regs)) ++report->const_regs;
+
+    const flow_val unknown = {VAL_UNKNOWN, 0};
+
+    switch (cur->handler)
+    {
+        case CMD_PUSH:
+        {
+            flow_val val = {VAL_CONST, (cur->cmd & CMD_NUM_ARG) ? cur->val : 0};
+
+            if (cur->cmd & CMD_MEM_ARG) val = unknown;
+            else if (cur->cmd & CMD_REG_ARG)
+            {
+                if (regs[cur->reg].kind == VAL_CONST) val.val += regs[cur->reg].val;
+                else                                  val = unknown;
+            }
+
+            stk_push(fg, val);
+            break;
+        }
+
+        case CMD_POP:
+        {
+            flow_val val = stk_pop(fg);
+            if (!(cur->cmd & CMD_MEM_ARG) && (cur->cmd & CMD_REG_ARG)) regs[cur->reg] = val;
+            break;
+        }
+
+        case CMD_ADD: case CMD_SUB: case CMD_MUL: case CMD_DIV:
+        {
+            flow_val a   = stk_pop(fg);
+            flow_val b   = stk_pop(fg);
+            flow_val val = {VAL_CONST, 0};
+
+            if (a.kind != VAL_CONST || b.kind != VAL_CONST || !fold_cmd(cur, a.val, b.val, &val.val)) val = unknown;
+
+            stk_push(fg, val);
+            break;
+        }
+
+        case CMD_SQRT:
+            stk_pop (fg);
+            stk_push(fg, unknown);
+            break;
+
+        case CMD_IN:
+            stk_push(fg, unknown);
+            break;
+
+        case CMD_OUT:
+            stk_pop(fg);
+            break;
+
+        case CMD_MEMSET: case CMD_MEMCPY: case CMD_FILL_RECT:
+            for (int pop_cnt = (cur->handler == CMD_FILL_RECT) ? 5 : 3; pop_cnt > 0; --pop_cnt) stk_pop(fg);
+            break;
+
+        case CMD_JA : case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE : case CMD_JNE:
+            stk_pop(fg);
+            stk_pop(fg);
+            break;
+
+        case CMD_PUSH_MANY:
+        case CMD_POP_MANY:
+            fg->stk_size = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+*   @brief Replaces the register argument of "push" or of a memory argument by the constant if the register is a known constant.
+*
+*   @return true if the instruction is changed and false else
+*/
+
+static bool const_reg(instruction *const cur, const flow_val *regs)
+{
+    assert(cur  != nullptr);
+    assert(regs != nullptr);
+
+    if (!(cur->cmd & CMD_REG_ARG) || regs[cur->reg].kind != VAL_CONST) return false;
+    if (cur->handler != CMD_PUSH && !(cur->handler == CMD_POP && (cur->cmd & CMD_MEM_ARG))) return false;
+
+    cur->val  = regs[cur->reg].val + ((cur->cmd & CMD_NUM_ARG) ? cur->val : 0);
+    cur->cmd  = (unsigned char) ((cur->cmd & ~CMD_REG_ARG) | CMD_NUM_ARG);
+    cur->reg  = 0;
+
+    return true;
+}
+
+static void stk_push(flow_graph *fg, const flow_val val)
+{
+    assert(fg != nullptr);
+
+    fg->stk[fg->stk_size++] = val;
+}
+
+static flow_val stk_pop(flow_graph *fg)
+{
+    assert(fg != nullptr);
+
+    if (fg->stk_size == 0) return {VAL_UNKNOWN, 0};
+    return fg->stk[--fg->stk_size];
+}
+
+/**
+*   @brief Finds registers which are live at the beginning of every block: iterates blocks backward until nothing is changed.
+*/
+
+static void find_live(flow_graph *fg)
+{
+    assert(fg != nullptr);
+
+    bool is_changed = true;
+
+    while (is_changed)
+    {
+        is_changed = false;
+
+        for (int blk_cnt = fg->block_num - 1; blk_cnt >= 0; --blk_cnt)
+        {
+            flow_block *blk  = fg->blocks + blk_cnt;
+            unsigned    live = live_out(fg, blk);
+
+            for (int cmd_cnt = blk->end - 1; cmd_cnt >= blk->begin; --cmd_cnt) live = live_cmd(fg->program->cmds + cmd_cnt, live, nullptr);
+
+            if (live != blk->live_in)
+            {
+                blk->live_in = live;
+                is_changed   = true;
+            }
+        }
+    }
+}
+
+/**
+*   @brief Finds registers which are live before the instruction.
+*
+*   @param cur    [in][out] - instruction
+*   @param live   [in]      - registers which are live after the instruction
+*   @param report [out]     - if it is not nullptr, "pop reg" of the register which is not live is replaced by "pop void" and counted in it
+*
+*   @return registers which are live before the instruction
+*/
+
+static unsigned live_cmd(instruction *const cur, unsigned live, opt_report *const report)
+{
+    assert(cur != nullptr);
+
+    switch (cur->handler)
+    {
+        case CMD_CALL:
+        case CMD_RET:
+            return ALL_REGS;
+
+        case CMD_HLT:
+            return 0;
+
+        case CMD_POP:
+            if (cur->cmd & CMD_MEM_ARG) break;
+            if (!(cur->cmd & CMD_REG_ARG)) return live;
+
+            if (report != nullptr && !(live & (1u << cur->reg)))
+            {
+                cur->cmd = CMD_POP | CMD_NUM_ARG;
+                cur->reg = 0;
+
+                ++report->dead_pops;
+                return live;
+            }
+            return live & ~(1u << cur->reg);
+
+        case CMD_PUSH:
+            break;
+
+        default:
+            return live;
+    }
+
+    if (cur->cmd & CMD_REG_ARG) live |= 1u << cur->reg;
+    return live;
+}
+
+/**
+*   @brief Finds registers which are live at the end of the block.
+*/
+
+static unsigned live_out(const flow_graph *fg, const flow_block *blk)
+{
+    assert(fg  != nullptr);
+    assert(blk != nullptr);
+
+    unsigned live = 0;
+
+    for (int succ_cnt = 0; succ_cnt < 2; ++succ_cnt)
+    {
+        if (blk->succ[succ_cnt] != -1) live |= fg->blocks[blk->succ[succ_cnt]].live_in;
+    }
+
+    return live;
+}
+
+/**
+*   @brief Removes instructions of the blocks which are not reached. Removed instructions are mapped to the next instruction.
+*
+*   @return number of removed instructions
+*/
+
+static int drop_unreached(flow_graph *fg, int *const cmd_map, const int map_size)
+{
+    assert(fg != nullptr);
+
+    decoded *program = fg->program;
+    int      cmd_num = program->size;
+
+    int *new_index = (int *) calloc(cmd_num + 1, sizeof(int));
+    assert(new_index != nullptr);
+
+    int new_num = 0;
+
+    for (int cmd_cnt = 0; cmd_cnt < cmd_num; ++cmd_cnt)
+    {
+        new_index[cmd_cnt] = new_num;
+        if (fg->blocks[fg->block_of[cmd_cnt]].is_reached) program->cmds[new_num++] = program->cmds[cmd_cnt];
+    }
+    new_index[cmd_num] = new_num;
+
+    if (new_num == cmd_num)
+    {
+        free(new_index);
+        return 0;
+    }
+
+    program->size = new_num;
+    program->cmds[new_num] = {CMD_NOT_EXICTING, CMD_NOT_EXICTING, 0, 0, 0, nullptr};
+
+    for (int cmd_cnt = 0; cmd_cnt < new_num; ++cmd_cnt)
+    {
+        instruction *cur = program->cmds + cmd_cnt;
+        if (is_jmp(cur->handler)) cur->jmp = new_index[cur->jmp];
+    }
+
+    for (int map_cnt = 0; cmd_map != nullptr && map_cnt < map_size; ++map_cnt) cmd_map[map_cnt] = new_index[cmd_map[map_cnt]];
+
+    free(new_index);
+    return cmd_num - new_num;
+}
+
+/**
+*   @brief Follows the chain of "jmp" from "target" up to JMP_CHAIN_MAX jumps.
+*
+*   @return index of the first instruction of the chain which is not "jmp"
+*/
+
+static int follow_jmp(const decoded *const program, int target)
+{
+    assert(program != nullptr);
+
+    for (int jmp_cnt = 0; jmp_cnt < JMP_CHAIN_MAX; ++jmp_cnt)
+    {
+        const instruction *next = program->cmds + target;
+        if (next->handler != CMD_JMP || next->jmp == target) break;
+
+        target = next->jmp;
+    }
+
+    return target;
+}
+
+static bool is_jmp(const unsigned char handler)
+{
+    return handler == CMD_JMP || handler == CMD_CALL || (handler >= CMD_JA && handler <= CMD_JNE);
+}
+
+static bool is_num_push(const instruction *cur)
+{
+    assert(cur != nullptr);
+
+    return cur->cmd == (CMD_PUSH | CMD_NUM_ARG);
+}
@@ -0,0 +1,46 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "decode.h"
+
+/*
+ * Decision about the routine which is called by CALL: calls of it are replaced by copies of its body or not.
+ */
+
+struct opt_inline
+{
+    int target;         // index of the first instruction of the routine before inlining
+    int size;           // instructions of the routine with its RET, 0 if it is not found
+    int call_num;
+    int inlined_num;
+
+    const char *reason; // why the calls are not inlined, nullptr if all of them are
+};
+
+struct opt_report
+{
+    int cmd_num;        // instructions before optimizations
+    int folded;         // "push a / push b / op" replaced by "push (b op a)"
+    int push_pop;       // removed pairs "push / pop" without argument
+    int jmp_next;       // removed jumps to the next instruction
+    int jmp_chains;     // jumps retargeted from "jmp" to its target
+    int tail_calls;     // "call L / ret" replaced by "jmp L / ret"
+    int jcc_folded;     // "push a / push b / ja L" replaced by "jmp L" or by nothing
+
+    int const_regs;     // registers replaced by their known constant values
+    int dead_pops;      // "pop reg" replaced by "pop void"
+    int unreachable;    // removed unreachable instructions
+
+    int inline_added;   // instructions added by inlining
+    int inline_num;
+    opt_inline *inlines;
+};
+
+void optimize_program    (decoded *const program, int *const cmd_map, const int map_size, const int inline_budget, opt_report *const report);
+bool optimize_dataflow   (decoded *const program, int *const cmd_map, const int map_size, opt_report *const report);
+bool optimize_peephole   (decoded *const program, int *const cmd_map, const int map_size, opt_report *const report);
+bool optimize_tail_calls (decoded *const program, opt_report *const report);
+bool optimize_inline     (decoded *const program, int *const cmd_map, const int map_size, const int budget, opt_report *const report);
+void opt_report_dtor     (opt_report *const report);
+
+#endif //OPTIMIZE_H
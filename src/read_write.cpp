@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <assert.h>
 
 #include "read_write.h"
@@ -68,4 +71,74 @@ unsigned get_file_size(const char *file_name)
     if (StatRet == -1) return -1;
 
     return BuffSize.st_size;
-}
\ No newline at end of file
+}
+/**
+*   @brief Maps the file "file_name" in memory for reading. Pages are read on demand and can be dropped after reading,
+*   @brief so the file is not copied and doesn't need memory of its size.
+*
+*   @param file_name [in]  - name of the file to map
+*   @param size_ptr  [out] - pointer to the size of the file "file_name"
+*
+*   @return pointer to the data of the file and nullptr in case of error
+*
+*   @note the data must be unmapped by "unmap_file()"
+*/
+
+const void *map_file(const char *file_name, size_t *const size_ptr)
+{
+    assert(file_name != nullptr);
+    assert(size_ptr  != nullptr);
+
+    static const char empty_file[1] = "";
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd == -1) return nullptr;
+
+    struct stat file_stat = {};
+    if (fstat(fd, &file_stat) == -1)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    *size_ptr = (size_t) file_stat.st_size;
+    if (*size_ptr == 0)
+    {
+        close(fd);
+        return empty_file;
+    }
+
+    void *data = mmap(nullptr, *size_ptr, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) return nullptr;
+
+    madvise(data, *size_ptr, MADV_SEQUENTIAL);
+
+    return data;
+}
+
+void unmap_file(const void *data, const size_t size)
+{
+    if (data == nullptr || size == 0) return;
+
+    munmap((void *) data, size);
+}
+
+/**
+*   @brief Drops the pages of the first "size" bytes of the file mapped by "map_file()" from memory.
+*   @brief They are read from the file again if they are accessed later.
+*
+*   @param data [in] - pointer to the data of the file
+*   @param size [in] - number of bytes which are not needed now
+*/
+
+void drop_file_pages(const void *data, const size_t size)
+{
+    if (data == nullptr || size == 0) return;
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t drop_size = size - size % page_size;
+
+    if (drop_size != 0) madvise((void *) data, drop_size, MADV_DONTNEED);
+}
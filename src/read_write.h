@@ -4,6 +4,10 @@
 void     *read_file   (const char *file_name, size_t *const size_ptr);
 bool     write_file   (const char *file_name, void *data, const int data_size);
 
+const void *map_file   (const char *file_name, size_t *const size_ptr);
+void        unmap_file (const void *data, const size_t size);
+void   drop_file_pages (const void *data, const size_t size);
+
 unsigned get_file_size(const char *file_name);
 
 #endif //READ_WRITE
\ No newline at end of file
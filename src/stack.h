@@ -1,21 +1,89 @@
 #ifndef STACK_H
 #define STACK_H
 
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+ * Typed stack. It grows twice when it is full and never shrinks,
+ * so pushes and pops don't call the allocator after the stack has reached its maximum size.
+ */
+
+const size_t STACK_MIN_CAPACITY = 64;
+
+template <typename T>
 struct stack
 {
-    void *data;
+    T *data;
 
     size_t size;
     size_t capacity;
-    size_t el_size;
 };
 
-bool  stack_empty   (stack *const stk);
+template <typename T>
+void stack_reserve(stack<T> *const stk, const size_t capacity)
+{
+    assert(stk != nullptr);
+
+    if (capacity <= stk->capacity) return;
+
+    stk->capacity = capacity;
+    stk->data     = (T *) realloc(stk->data, sizeof(T) * stk->capacity);
+    assert(stk->data != nullptr);
+}
+
+template <typename T>
+void stack_ctor(stack<T> *const stk)
+{
+    assert(stk != nullptr);
+
+    *stk = {};
+    stack_reserve(stk, STACK_MIN_CAPACITY);
+}
+
+template <typename T>
+void stack_dtor(stack<T> *const stk)
+{
+    assert(stk != nullptr);
+
+    free(stk->data);
+    *stk = {};
+}
+
+template <typename T>
+inline bool stack_empty(const stack<T> *const stk)
+{
+    return stk->size == 0;
+}
+
+template <typename T>
+inline void stack_push(stack<T> *const stk, const T push_val)
+{
+    if (stk->size == stk->capacity) stack_reserve(stk, 2 * stk->capacity);
+
+    stk->data[stk->size++] = push_val;
+}
 
-void  stack_ctor    (stack *const stk, const size_t el_size);
-void  stack_push    (stack *const stk, const void *push_val);
-void *stack_pop     (stack *const stk);
-void *stack_front   (stack *const stk);
-void  stack_realloc (stack *const stk);
+/**
+*   @brief Removes the top element. The stack must not be empty.
+*
+*   @return removed element
+*/
+
+template <typename T>
+inline T stack_pop(stack<T> *const stk)
+{
+    return stk->data[--stk->size];
+}
+
+/**
+*   @brief Gets the top element. The stack must not be empty.
+*/
+
+template <typename T>
+inline T &stack_front(stack<T> *const stk)
+{
+    return stk->data[stk->size - 1];
+}
 
-#endif //STACK_H
\ No newline at end of file
+#endif //STACK_H
@@ -5,6 +5,10 @@
 
 #include "tag.h"
 
+static unsigned tag_hash       (const char *ptr, const int size);
+static size_t   tag_slot_find  (const tag *const label, const char *ptr, const int size);
+static void     tag_index_grow (tag *const label);
+
 void tag_ctor(tag *const label)
 {
     assert(label !=nullptr);
@@ -12,17 +16,41 @@ void tag_ctor(tag *const label)
     *label = {};
     label->data     = (mark *) calloc(sizeof(mark), 4); //elementary tag cpapacity
     label->capacity = 4;
+
+    label->index_capacity = 8;
+    label->index          = (int *) malloc(sizeof(int) * label->index_capacity);
+    memset(label->index, -1, sizeof(int) * label->index_capacity);
+}
+
+void tag_dtor(tag *const label)
+{
+    assert(label != nullptr);
+
+    free(label->data);
+    free(label->index);
+
+    *label = {};
 }
 
+/**
+*   @brief Puts the mark in "label". Marks are not copied: "mark_ptr" must point to the source until "label" is destructed.
+*
+*   @return false if the mark is already in "label" and true else
+*/
+
 bool tag_push(tag *const label, mark push_val)
 {
     assert(label != nullptr);
 
-    if (tag_mark_find(label, push_val) != -1) return false;
+    size_t slot = tag_slot_find(label, push_val.mark_ptr, push_val.mark_size);
+    if (label->index[slot] != -1) return false;
 
     tag_realloc(label);
+    label->index[slot]         = (int) label->size;
     label->data[label->size++] = push_val;
 
+    if (2 * label->size > label->index_capacity) tag_index_grow(label);
+
     return true;
 }
 
@@ -31,24 +59,14 @@ int tag_string_find(tag *const label, const char *s)
     assert(label != nullptr);
     assert(s     != nullptr);
 
-    int len = strlen(s);
-    
-    for (int i = 0; i < label->size; ++i)
-    {
-        if (len == label->data[i].mark_size && !strncmp(s, label->data[i].mark_ptr, len)) return i;
-    }
-    return -1;
+    return label->index[tag_slot_find(label, s, (int) strlen(s))];
 }
 
 int tag_mark_find(tag *const label, const mark mrk)
 {
     assert(label != nullptr);
 
-    for (int i = 0; i < label->size; ++i)
-    {
-        if (mrk.mark_size == label->data[i].mark_size && !strncmp(mrk.mark_ptr, label->data[i].mark_ptr, mrk.mark_size)) return i;
-    }
-    return -1;
+    return label->index[tag_slot_find(label, mrk.mark_ptr, mrk.mark_size)];
 }
 
 void tag_realloc(tag *const label)
@@ -60,4 +78,64 @@ void tag_realloc(tag *const label)
         label->capacity *= 2;
         label->data      = (mark *) realloc(label->data, sizeof(mark) * label->capacity);
     }
-}
\ No newline at end of file
+}
+
+/**
+*   @brief FNV-1a hash of the string "ptr" of "size" symbols.
+*/
+
+static unsigned tag_hash(const char *ptr, const int size)
+{
+    unsigned hash = 2166136261u;
+
+    for (int cnt = 0; cnt < size; ++cnt)
+    {
+        hash ^= (unsigned char) ptr[cnt];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+*   @brief Finds the slot of the hash table containing the mark "ptr" of "size" symbols or the empty slot to put it in (linear probing).
+*/
+
+static size_t tag_slot_find(const tag *const label, const char *ptr, const int size)
+{
+    assert(label != nullptr);
+    assert(ptr   != nullptr);
+
+    size_t mask = label->index_capacity - 1;
+    size_t slot = tag_hash(ptr, size) & mask;
+
+    while (label->index[slot] != -1)
+    {
+        const mark *mrk = label->data + label->index[slot];
+
+        if (mrk->mark_size == size && !strncmp(mrk->mark_ptr, ptr, size)) return slot;
+
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void tag_index_grow(tag *const label)
+{
+    assert(label != nullptr);
+
+    free(label->index);
+
+    label->index_capacity *= 2;
+    label->index           = (int *) malloc(sizeof(int) * label->index_capacity);
+    memset(label->index, -1, sizeof(int) * label->index_capacity);
+
+    size_t mask = label->index_capacity - 1;
+
+    for (size_t mark_cnt = 0; mark_cnt < label->size; ++mark_cnt)
+    {
+        size_t slot = tag_hash(label->data[mark_cnt].mark_ptr, label->data[mark_cnt].mark_size) & mask;
+
+        while (label->index[slot] != -1) slot = (slot + 1) & mask;
+        label->index[slot] = (int) mark_cnt;
+    }
+}
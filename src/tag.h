@@ -1,6 +1,8 @@
 #ifndef TAG_H
 #define TAG_H
 
+#include <stddef.h>
+
 struct mark
 {
     char *mark_ptr;
@@ -15,6 +17,9 @@ struct tag
 
     size_t capacity;
     size_t size;
+
+    int   *index;           // open addressing hash table of indexes in "data", -1 - empty slot
+    size_t index_capacity;  // power of two, at least twice more than "size"
 };
 
 bool tag_push        (tag *const label, mark push_val);
@@ -23,6 +28,7 @@ int  tag_string_find (tag *const label, const char *s);
 int  tag_mark_find   (tag *const label, const mark mrk);
 
 void tag_ctor        (tag *const label);
+void tag_dtor        (tag *const label);
 void tag_realloc     (tag *const label);
 
-#endif //TAG_H
\ No newline at end of file
+#endif //TAG_H
@@ -0,0 +1,399 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cpu.h"
+#include "verify.h"
+
+const int WIDEN_LIMIT = 16; // updates of the state of one instruction before its maximal depth is considered unbounded
+
+const int ENTRY_NONE  = -1; // the instruction is reached from the beginning of the program, not from CALL
+const int ENTRY_MANY  = -2; // the instruction is reached from several routines
+
+/*
+ * State before the instruction. "Depth" is the size of the stack of values, "calls" is the size of the stack of return points.
+ * Minimal values are enough to prove that no command pops from an empty stack,
+ * maximal depth is used to reserve the stack before executing.
+ * "Entry" is the target of CALL which began the routine the instruction is executed in: RET returns only after CALLs of it.
+ */
+
+struct verify_state
+{
+    bool is_reached;
+    int  update_num;
+
+    long depth_min;
+    long depth_max;     // VERIFY_UNBOUNDED if the stack can grow infinitely
+    long calls_min;
+    int  entry;         // ENTRY_NONE, ENTRY_MANY or the index of the first instruction of the routine
+};
+
+struct verifier
+{
+    const decoded *program;
+
+    verify_state *states;
+
+    int *worklist;
+    int  worklist_size;
+    bool *in_worklist;
+
+    int *ret_sites;     // instructions after every CALL grouped by the target of CALL, the stack of return points is taken from CALL
+    int *site_first;    // sites after CALLs of the instruction "i" are from ret_sites[site_first[i]] to ret_sites[site_first[i + 1]]
+    int  ret_site_num;
+};
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static void group_ret_sites(verifier *vf);
+static bool verify_cmd     (verifier *vf, const int cmd_cnt);
+static void merge_ret      (verifier *vf, const int site, verify_state *const state);
+static bool get_effect     (const instruction *cur, long *const pops, long *const pushes);
+static bool is_blit_in_ram (const instruction *cur);
+static void merge_state    (verifier *vf, const int dst, const verify_state *src);
+static bool verify_fail    (const int cmd_cnt, const char *reason);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Proves that the program never pops from an empty stack of values or from an empty stack of return points,
+*   @brief never jumps outside the program and never pushes from or pops to a constant RAM cell outside RAM.
+*   @brief Walks the control flow graph of instructions: jumps, CALL to its target, RET to the instructions after CALLs of its routine,
+*   @brief the end of the program to its beginning (the program is executed again while the window is opened).
+*   @brief Prints the reason in stderr if the program can't be verified.
+*
+*   @param program   [in]  - decoded program
+*   @param max_depth [out] - maximal size of the stack of values or VERIFY_UNBOUNDED
+*
+*   @return true if the program is verified and false else
+*/
+
+bool verify_program(const decoded *const program, long *const max_depth)
+{
+    assert(program   != nullptr);
+    assert(max_depth != nullptr);
+
+    int state_num = program->size + 1;
+
+    verifier vf = {};
+    vf.program     = program;
+    vf.states      = (verify_state *) calloc(state_num, sizeof(verify_state));
+    vf.worklist    = (int *)          calloc(state_num, sizeof(int));
+    vf.in_worklist = (bool *)         calloc(state_num, sizeof(bool));
+    vf.ret_sites   = (int *)          calloc(state_num, sizeof(int));
+    vf.site_first  = (int *)          calloc(state_num + 1, sizeof(int));
+
+    assert(vf.states      != nullptr);
+    assert(vf.worklist    != nullptr);
+    assert(vf.in_worklist != nullptr);
+    assert(vf.ret_sites   != nullptr);
+    assert(vf.site_first  != nullptr);
+
+    group_ret_sites(&vf);
+
+    verify_state start = {true, 0, 0, 0, 0, ENTRY_NONE};
+    merge_state(&vf, 0, &start);
+
+    bool is_verified = true;
+
+    while (is_verified && vf.worklist_size > 0)
+    {
+        int cmd_cnt = vf.worklist[--vf.worklist_size];
+        vf.in_worklist[cmd_cnt] = false;
+
+        is_verified = verify_cmd(&vf, cmd_cnt);
+    }
+
+    *max_depth = 0;
+    for (int cmd_cnt = 0; is_verified && cmd_cnt < state_num; ++cmd_cnt)
+    {
+        const verify_state *state = vf.states + cmd_cnt;
+
+        if (!state->is_reached) continue;
+        if ( state->depth_max == VERIFY_UNBOUNDED)
+        {
+            *max_depth = VERIFY_UNBOUNDED;
+            break;
+        }
+        if (state->depth_max > *max_depth) *max_depth = state->depth_max;
+    }
+
+    free(vf.states);
+    free(vf.worklist);
+    free(vf.in_worklist);
+    free(vf.ret_sites);
+    free(vf.site_first);
+
+    return is_verified;
+}
+
+/**
+*   @brief Fills "vf->ret_sites" with the instructions after CALLs sorted by the target of CALL (counting sort).
+*   @brief CALLs outside the program are skipped: the verifier fails on them.
+*/
+
+static void group_ret_sites(verifier *vf)
+{
+    assert(vf != nullptr);
+
+    const decoded *program = vf->program;
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (cur->handler == CMD_CALL && cur->jmp >= 0 && cur->jmp <= program->size) ++vf->site_first[cur->jmp + 1];
+    }
+    for (int cmd_cnt = 0; cmd_cnt <= program->size; ++cmd_cnt) vf->site_first[cmd_cnt + 1] += vf->site_first[cmd_cnt];
+
+    vf->ret_site_num = vf->site_first[program->size + 1];
+
+    int *site_end = (int *) calloc(program->size + 1, sizeof(int));
+    assert(site_end != nullptr);
+
+    memcpy(site_end, vf->site_first, (program->size + 1) * sizeof(int));
+
+    for (int cmd_cnt = 0; cmd_cnt < program->size; ++cmd_cnt)
+    {
+        const instruction *cur = program->cmds + cmd_cnt;
+        if (cur->handler == CMD_CALL && cur->jmp >= 0 && cur->jmp <= program->size) vf->ret_sites[site_end[cur->jmp]++] = cmd_cnt + 1;
+    }
+
+    free(site_end);
+}
+
+/**
+*   @brief Checks the instruction "cmd_cnt" in its current state and passes the state after it to its successors.
+*
+*   @return false if the instruction can fail and true else
+*/
+
+static bool verify_cmd(verifier *vf, const int cmd_cnt)
+{
+    assert(vf != nullptr);
+
+    const decoded     *program = vf->program;
+    const instruction *cur     = program->cmds + cmd_cnt;
+    verify_state       state   = vf->states[cmd_cnt];
+
+    if (cmd_cnt == program->size)
+    {
+        merge_state(vf, 0, &state);
+        return true;
+    }
+
+    long pops   = 0;
+    long pushes = 0;
+    if (!get_effect(cur, &pops, &pushes)) return verify_fail(cmd_cnt, "undefined command");
+
+    if (state.depth_min < pops) return verify_fail(cmd_cnt, "the stack can be empty");
+
+    state.depth_min += pushes - pops;
+    if (state.depth_max != VERIFY_UNBOUNDED) state.depth_max += pushes - pops;
+
+    if ((cur->handler == CMD_PUSH || cur->handler == CMD_POP) && (cur->cmd & CMD_MEM_ARG) && !(cur->cmd & CMD_REG_ARG) &&
+        cur->val >= (stack_el) RAM_NUM)
+    {
+        return verify_fail(cmd_cnt, "RAM index is out of RAM");
+    }
+    if (cur->handler == CMD_POP_MANY)
+    {
+        for (stack_el val_cnt = 0; val_cnt < cur->val; ++val_cnt)
+        {
+            if (cur->data[val_cnt] >= (stack_el) RAM_NUM) return verify_fail(cmd_cnt, "RAM index is out of RAM");
+        }
+    }
+    if (cur->handler == CMD_BLIT && !is_blit_in_ram(cur)) return verify_fail(cmd_cnt, "RAM index is out of RAM");
+
+    switch (cur->handler)
+    {
+        case CMD_HLT:
+            return true;
+
+        case CMD_JA : case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE : case CMD_JNE:
+            if (cur->jmp < 0 || cur->jmp > program->size) return verify_fail(cmd_cnt, "jump outside the program");
+
+            merge_state(vf, cmd_cnt + 1, &state);
+            merge_state(vf, cur->jmp,    &state);
+            return true;
+
+        case CMD_JMP:
+            if (cur->jmp < 0 || cur->jmp > program->size) return verify_fail(cmd_cnt, "jump outside the program");
+
+            merge_state(vf, cur->jmp, &state);
+            return true;
+
+        case CMD_CALL:
+        {
+            if (cur->jmp < 0 || cur->jmp > program->size) return verify_fail(cmd_cnt, "jump outside the program");
+
+            // after the return the stack of return points and the routine are the same as before CALL
+            if (vf->states[cmd_cnt + 1].is_reached)
+            {
+                verify_state ret_state = vf->states[cmd_cnt + 1];
+                ret_state.calls_min = state.calls_min;
+                ret_state.entry     = state.entry;
+                merge_state(vf, cmd_cnt + 1, &ret_state);
+            }
+
+            ++state.calls_min;
+            state.entry = cur->jmp;
+            merge_state(vf, cur->jmp, &state);
+            return true;
+        }
+
+        case CMD_RET:
+        {
+            if (state.calls_min < 1) return verify_fail(cmd_cnt, "RET can be executed without CALL");
+
+            // the routine is unknown: RET can return after any CALL
+            int site_beg = (state.entry < 0) ? 0                : vf->site_first[state.entry];
+            int site_end = (state.entry < 0) ? vf->ret_site_num : vf->site_first[state.entry + 1];
+
+            for (int site_cnt = site_beg; site_cnt < site_end; ++site_cnt) merge_ret(vf, vf->ret_sites[site_cnt], &state);
+            return true;
+        }
+
+        default:
+            merge_state(vf, cmd_cnt + 1, &state);
+            return true;
+    }
+}
+
+/**
+*   @brief Passes the state before RET to the instruction "site" after CALL if CALL is reached.
+*/
+
+static void merge_ret(verifier *vf, const int site, verify_state *const state)
+{
+    assert(vf    != nullptr);
+    assert(state != nullptr);
+
+    const verify_state *call_state = vf->states + site - 1;
+    if (!call_state->is_reached) return;
+
+    state->calls_min = call_state->calls_min;
+    state->entry     = call_state->entry;
+    merge_state(vf, site, state);
+}
+
+/**
+*   @brief Joins "src" with the state of the instruction "dst" and adds "dst" to the worklist if its state is changed.
+*/
+
+static void merge_state(verifier *vf, const int dst, const verify_state *src)
+{
+    assert(vf  != nullptr);
+    assert(src != nullptr);
+
+    verify_state *state = vf->states + dst;
+
+    if (!state->is_reached) *state = *src;
+    else
+    {
+        verify_state old = *state;
+
+        if (src->depth_min < state->depth_min) state->depth_min = src->depth_min;
+        if (src->calls_min < state->calls_min) state->calls_min = src->calls_min;
+        if (src->entry     != state->entry)     state->entry     = ENTRY_MANY;
+
+        if (state->depth_max != VERIFY_UNBOUNDED && (src->depth_max == VERIFY_UNBOUNDED || src->depth_max > state->depth_max))
+        {
+            state->depth_max = (state->update_num >= WIDEN_LIMIT) ? VERIFY_UNBOUNDED : src->depth_max;
+        }
+
+        if (old.depth_min == state->depth_min && old.calls_min == state->calls_min && old.depth_max == state->depth_max &&
+            old.entry     == state->entry) return;
+    }
+
+    ++state->update_num;
+
+    if (vf->in_worklist[dst]) return;
+
+    vf->in_worklist[dst] = true;
+    vf->worklist[vf->worklist_size++] = dst;
+}
+
+/**
+*   @brief Gets the number of values the instruction pops from the stack and pushes in it.
+*
+*   @return false if the command is undefined and true else
+*/
+
+static bool get_effect(const instruction *cur, long *const pops, long *const pushes)
+{
+    assert(cur    != nullptr);
+    assert(pops   != nullptr);
+    assert(pushes != nullptr);
+
+    *pops   = 0;
+    *pushes = 0;
+
+    switch (cur->handler)
+    {
+        case CMD_PUSH: case CMD_IN:                         *pushes = 1;                break;
+        case CMD_POP : case CMD_OUT:    *pops = 1;                                      break;
+        case CMD_SQRT:                  *pops = 1;          *pushes = 1;                break;
+
+        case CMD_ADD: case CMD_SUB: case CMD_MUL: case CMD_DIV:
+                                        *pops = 2;          *pushes = 1;                break;
+
+        case CMD_JA : case CMD_JAE: case CMD_JB:
+        case CMD_JBE: case CMD_JE : case CMD_JNE:
+                                        *pops = 2;                                      break;
+
+        case CMD_PUSH_MANY:                                 *pushes = (long) cur->val;  break;
+        case CMD_POP_MANY:              *pops = (long) cur->val;                        break;
+
+        case CMD_MEMSET: case CMD_MEMCPY:
+                                        *pops = 3;                                      break;
+        case CMD_FILL_RECT:             *pops = 5;                                      break;
+
+        case CMD_HLT: case CMD_JMP: case CMD_CALL: case CMD_RET: case CMD_DRAW:
+        case CMD_BLIT:                                                                  break;
+
+        default:
+            return false;
+    }
+    return true;
+}
+
+/**
+*   @brief Checks that the spans of BLIT (see "decode.h") end inside RAM.
+*/
+
+static bool is_blit_in_ram(const instruction *cur)
+{
+    assert(cur != nullptr);
+
+    stack_el ram_pos = 0;
+    stack_el val_cnt = 0;
+
+    while (val_cnt < cur->val)
+    {
+        if (cur->data[val_cnt] > (stack_el) RAM_NUM - ram_pos) return false;
+        ram_pos += cur->data[val_cnt];
+
+        stack_el run_num = cur->data[val_cnt + 1];
+        val_cnt += 2;
+
+        for (stack_el run_cnt = 0; run_cnt < run_num; ++run_cnt, val_cnt += 2)
+        {
+            if (cur->data[val_cnt] > (stack_el) RAM_NUM - ram_pos) return false;
+            ram_pos += cur->data[val_cnt];
+        }
+    }
+
+    return true;
+}
+
+static bool verify_fail(const int cmd_cnt, const char *reason)
+{
+    assert(reason != nullptr);
+
+    fprintf(stderr, "VERIFIER: instruction %d: %s, the program is executed with checks\n", cmd_cnt, reason);
+    return false;
+}
@@ -0,0 +1,10 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "decode.h"
+
+const long VERIFY_UNBOUNDED = -1;
+
+bool verify_program (const decoded *const program, long *const max_depth);
+
+#endif //VERIFY_H
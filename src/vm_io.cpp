@@ -0,0 +1,274 @@
+/** @file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define RED    "\e[1;31m"
+#define CANCEL "\e[0m"
+
+#include "vm_io.h"
+
+const int MAX_NUM_LEN = 21; // digits of the maximal "stack_el" and '\n'
+
+/*-----------------------------------------FUNCTION_DECLARATION-----------------------------------------*/
+
+static bool in_refill (vm_io *const io);
+static int  in_peek   (vm_io *const io);
+static bool in_number (vm_io *const io, stack_el *const val);
+static void log_push  (vm_io *const io, const stack_el val);
+
+/*------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Opens input and output of the program ("IN" and "OUT" commands).
+*
+*   @param io       [out] - pointer to the "vm_io" to open
+*   @param in_file  [in]  - name of the input  file, nullptr for stdin
+*   @param out_file [in]  - name of the output file, nullptr for stdout
+*
+*   @return true if the files are opened and false else
+*/
+
+bool vm_io_ctor(vm_io *const io, const char *in_file, const char *out_file)
+{
+    assert(io != nullptr);
+
+    *io = {};
+    io->in_fd  = STDIN_FILENO;
+    io->out_fd = STDOUT_FILENO;
+
+    if (in_file != nullptr && (io->in_fd = open(in_file, O_RDONLY)) == -1)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\" to read input from\n", in_file);
+        return false;
+    }
+    if (out_file != nullptr && (io->out_fd = open(out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+    {
+        fprintf(stderr, RED "ERROR: " CANCEL "Can't open the file \"%s\" to write output in\n", out_file);
+        if (in_file != nullptr) close(io->in_fd);
+        return false;
+    }
+
+    io->in_buf  = (char *) calloc(VM_IO_BUF_SIZE, sizeof(char));
+    io->out_buf = (char *) calloc(VM_IO_BUF_SIZE, sizeof(char));
+    assert(io->in_buf  != nullptr);
+    assert(io->out_buf != nullptr);
+
+    io->is_out_tty = isatty(io->out_fd);
+
+    return true;
+}
+
+void vm_io_dtor(vm_io *const io)
+{
+    assert(io != nullptr);
+
+    vm_io_flush(io);
+
+    if (io->in_fd  != STDIN_FILENO ) close(io->in_fd);
+    if (io->out_fd != STDOUT_FILENO) close(io->out_fd);
+
+    free(io->in_buf);
+    free(io->out_buf);
+    free(io->log);
+
+    *io = {};
+}
+
+/**
+*   @brief Reads the next number of the input as "scanf("%llu")" does:
+*   @brief skips spaces, takes an optional sign and decimal digits, negative numbers are wrapped.
+*   @brief In VM_IO_RECORD the number is kept, in VM_IO_REPLAY the next kept number is taken instead of the input.
+*
+*   @param io  [in]  - input
+*   @param val [out] - read number, it isn't changed if there is no number
+*
+*   @return true if the number is read and false else
+*/
+
+bool vm_io_read(vm_io *const io, stack_el *const val)
+{
+    assert(io  != nullptr);
+    assert(val != nullptr);
+
+    if (io->mode == VM_IO_REPLAY)
+    {
+        if (io->log_pos == io->log_size) return false;
+
+        *val = io->log[io->log_pos++];
+        return true;
+    }
+
+    if (!in_number(io, val)) return false;
+
+    if (io->mode == VM_IO_RECORD) log_push(io, *val);
+    return true;
+}
+
+/**
+*   @brief Sets the mode of the input and the output (see "VM_IO_MODE").
+*   @brief VM_IO_RECORD forgets the numbers kept before, VM_IO_REPLAY starts from the first kept number.
+*/
+
+void vm_io_mode(vm_io *const io, const VM_IO_MODE mode)
+{
+    assert(io != nullptr);
+
+    io->mode = mode;
+
+    if (mode == VM_IO_RECORD) io->log_size = 0;
+    if (mode == VM_IO_REPLAY) io->log_pos  = 0;
+}
+
+/**
+*   @brief Parses the next number of the input, see "vm_io_read()".
+*/
+
+static bool in_number(vm_io *const io, stack_el *const val)
+{
+    assert(io  != nullptr);
+    assert(val != nullptr);
+
+    int sym = in_peek(io);
+    while (sym == ' ' || (sym >= '\t' && sym <= '\r')) 
+    {
+        ++io->in_pos;
+        sym = in_peek(io);
+    }
+
+    bool is_neg = false;
+    if (sym == '-' || sym == '+')
+    {
+        is_neg = (sym == '-');
+        ++io->in_pos;
+        sym = in_peek(io);
+    }
+
+    if (sym < '0' || sym > '9') return false;
+
+    stack_el num        = 0;
+    bool     is_overflow = false;
+
+    while (sym >= '0' && sym <= '9')
+    {
+        stack_el digit = (stack_el) (sym - '0');
+
+        if (num > (~0ULL - digit) / 10) is_overflow = true;
+        num = 10 * num + digit;
+
+        ++io->in_pos;
+        sym = in_peek(io);
+    }
+
+    if      (is_overflow) *val = ~0ULL;
+    else if (is_neg)      *val = 0 - num;
+    else                  *val = num;
+
+    return true;
+}
+
+/**
+*   @brief Writes the number and '\n' to the output buffer. The buffer is flushed when it is full.
+*/
+
+void vm_io_write(vm_io *const io, const stack_el val)
+{
+    assert(io != nullptr);
+
+    if (io->mode == VM_IO_RECORD) return;
+    if (io->out_size + MAX_NUM_LEN > VM_IO_BUF_SIZE) vm_io_flush(io);
+
+    char digits[MAX_NUM_LEN] = "";
+    int  digit_num           = 0;
+
+    stack_el num = val;
+    do
+    {
+        digits[digit_num++] = (char) ('0' + num % 10);
+        num /= 10;
+    }
+    while (num != 0);
+
+    while (digit_num > 0) io->out_buf[io->out_size++] = digits[--digit_num];
+    io->out_buf[io->out_size++] = '\n';
+}
+
+/**
+*   @brief Writes the output buffer to the output file.
+*/
+
+void vm_io_flush(vm_io *const io)
+{
+    assert(io != nullptr);
+
+    size_t written = 0;
+    while (written < io->out_size)
+    {
+        ssize_t res = write(io->out_fd, io->out_buf + written, io->out_size - written);
+        if (res <= 0) break;
+
+        written += (size_t) res;
+    }
+    io->out_size = 0;
+}
+
+/**
+*   @brief Gets the next symbol of the input without taking it.
+*
+*   @return the symbol or EOF
+*/
+
+static int in_peek(vm_io *const io)
+{
+    if (io->in_pos == io->in_size && !in_refill(io)) return EOF;
+
+    return (unsigned char) io->in_buf[io->in_pos];
+}
+
+/**
+*   @brief Reads the next block of the input. The output is flushed before it if it is the terminal.
+*
+*   @return false if the input is ended and true else
+*/
+
+static bool in_refill(vm_io *const io)
+{
+    assert(io != nullptr);
+
+    if (io->in_eof) return false;
+    if (io->is_out_tty) vm_io_flush(io);
+
+    ssize_t res = read(io->in_fd, io->in_buf, VM_IO_BUF_SIZE);
+    if (res <= 0)
+    {
+        io->in_eof = true;
+        return false;
+    }
+
+    io->in_size = (size_t) res;
+    io->in_pos  = 0;
+
+    return true;
+}
+
+/**
+*   @brief Keeps the read number for VM_IO_REPLAY.
+*/
+
+static void log_push(vm_io *const io, const stack_el val)
+{
+    assert(io != nullptr);
+
+    if (io->log_size == io->log_capacity)
+    {
+        io->log_capacity = (io->log_capacity == 0) ? VM_IO_BUF_SIZE / sizeof(stack_el) : 2 * io->log_capacity;
+        io->log          = (stack_el *) realloc(io->log, io->log_capacity * sizeof(stack_el));
+        assert(io->log != nullptr);
+    }
+
+    io->log[io->log_size++] = val;
+}
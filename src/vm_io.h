@@ -0,0 +1,49 @@
+#ifndef VM_IO_H
+#define VM_IO_H
+
+#include <stddef.h>
+
+#include "machine.h"
+
+const size_t VM_IO_BUF_SIZE = 1 << 16;
+
+/*
+ * Numbers read by "IN" can be recorded and replayed to execute the program twice on the same input ("--jit-check").
+ */
+
+enum VM_IO_MODE
+{
+    VM_IO_DIRECT , // numbers are read from the input
+    VM_IO_RECORD , // numbers are read from the input and kept, the output is dropped
+    VM_IO_REPLAY   // kept numbers are read again, the input isn't read
+};
+
+struct vm_io
+{
+    int    in_fd;
+    char  *in_buf;
+    size_t in_size;             // number of read bytes in "in_buf"
+    size_t in_pos;              // position of the first unparsed byte
+    bool   in_eof;
+
+    int    out_fd;
+    char  *out_buf;
+    size_t out_size;
+
+    bool   is_out_tty;          // output to the terminal is flushed before every read from the input
+
+    VM_IO_MODE mode;
+    stack_el  *log;             // numbers read in VM_IO_RECORD
+    size_t     log_size;
+    size_t     log_capacity;
+    size_t     log_pos;         // next number to read in VM_IO_REPLAY
+};
+
+bool vm_io_ctor  (vm_io *const io, const char *in_file, const char *out_file);
+void vm_io_dtor  (vm_io *const io);
+bool vm_io_read  (vm_io *const io, stack_el *const val);
+void vm_io_write (vm_io *const io, const stack_el val);
+void vm_io_flush (vm_io *const io);
+void vm_io_mode  (vm_io *const io, const VM_IO_MODE mode);
+
+#endif //VM_IO_H
@@ -0,0 +1,9 @@
+#"push [reg]" outside RAM stops the program with "MEMORY LIMIT EXCEEDED" by every engine, "out" is never executed
+
+push 700000         #the index is greater than the size of RAM
+pop rex
+
+push [rex]
+out
+
+hlt